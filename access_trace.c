@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "access_trace.h"
+#include "latency_hist.h"
+
+#define TRACE_HEADER_BYTES 16 // magic, version, record size
+
+typedef struct TraceRing { // single producer (its thread), single consumer (the drainer)
+    _Atomic uint64_t head;     // next slot the producer fills
+    char padHead[56];          // keep producer and drainer off each other's cache line
+    _Atomic uint64_t tail;     // next slot the drainer reads
+    char padTail[56];
+    TraceRecord *slots;
+    const void *owner;         // address of the producer's thread-local token
+} TraceRing;
+
+struct AccessTrace {
+    FILE *out;
+    uint64_t mask;                            // ring size - 1
+    unsigned long long id;                    // tells this trace from an older one at the same address
+    _Atomic int numRings;
+    _Atomic(TraceRing*) rings[TRACE_MAX_THREADS];
+    _Atomic unsigned long long dropped;
+};
+
+static _Atomic unsigned long long nextTraceId = 1;
+
+// the calling thread's ring in the trace it last recorded to
+static __thread unsigned long long tlsTraceId = 0;
+static __thread TraceRing *tlsRing = NULL;
+static __thread int tlsThread = 0;
+static __thread char tlsToken;
+
+static TraceRing *ringOfThread(AccessTrace *trace) { // register the caller on first use; NULL when out of rings
+    if (tlsTraceId == trace->id) return tlsRing;
+    tlsTraceId = trace->id;
+    tlsRing = NULL;
+
+    // a thread switching between traces finds its ring in each again
+    int n = atomic_load(&trace->numRings);
+    if (n > TRACE_MAX_THREADS) n = TRACE_MAX_THREADS;
+    for (int i = 0; i < n; i++) {
+        TraceRing *ring = atomic_load_explicit(&trace->rings[i], memory_order_acquire);
+        if (ring != NULL && ring->owner == &tlsToken) {
+            tlsRing = ring;
+            tlsThread = i;
+            return ring;
+        }
+    }
+    int idx = atomic_fetch_add(&trace->numRings, 1);
+    if (idx >= TRACE_MAX_THREADS) return NULL;
+    TraceRing *ring = (TraceRing*)calloc(1, sizeof(TraceRing));
+    if (ring == NULL) return NULL;
+    ring->slots = (TraceRecord*)malloc(sizeof(TraceRecord) * (trace->mask + 1));
+    if (ring->slots == NULL) {
+        free(ring);
+        return NULL;
+    }
+    ring->owner = &tlsToken;
+    atomic_store_explicit(&trace->rings[idx], ring, memory_order_release);
+    tlsRing = ring;
+    tlsThread = idx;
+    return ring;
+}
+
+static RC writeRing(AccessTrace *trace, TraceRing *ring) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    while (tail < head) {
+        // up to the end of the slot array, then wrap
+        uint64_t at = tail & trace->mask;
+        uint64_t n = head - tail;
+        if (at + n > trace->mask + 1) n = trace->mask + 1 - at;
+        if (fwrite(&ring->slots[at], sizeof(TraceRecord), n, trace->out) != n) return RC_WRITE_FAILED;
+        tail += n;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    return RC_OK;
+}
+
+RC openAccessTrace(AccessTrace **trace, const char *fileName, int ringRecords) {
+    if (trace == NULL || fileName == NULL || ringRecords <= 0) return RC_FILE_HANDLE_NOT_INIT;
+    AccessTrace *t = (AccessTrace*)calloc(1, sizeof(AccessTrace));
+    if (t == NULL) return RC_FILE_HANDLE_NOT_INIT;
+
+    uint64_t size = 1;
+    while (size < (uint64_t)ringRecords) size <<= 1;
+    t->mask = size - 1;
+    t->id = atomic_fetch_add(&nextTraceId, 1);
+
+    t->out = fopen(fileName, "wb");
+    if (t->out == NULL) {
+        free(t);
+        return RC_FILE_NOT_FOUND;
+    }
+    uint32_t version = TRACE_VERSION, recordBytes = sizeof(TraceRecord);
+    if (fwrite(TRACE_MAGIC, 1, 8, t->out) != 8 || fwrite(&version, 4, 1, t->out) != 1
+        || fwrite(&recordBytes, 4, 1, t->out) != 1) {
+        fclose(t->out);
+        free(t);
+        return RC_WRITE_FAILED;
+    }
+    *trace = t;
+    return RC_OK;
+}
+
+void traceAccess(AccessTrace *trace, TraceOp op, int fileId, int pageNum) {
+    TraceRing *ring = ringOfThread(trace);
+    if (ring == NULL) {
+        atomic_fetch_add_explicit(&trace->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) > trace->mask) {
+        atomic_fetch_add_explicit(&trace->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    TraceRecord *r = &ring->slots[head & trace->mask];
+    r->tsNs = lhNowNs();
+    r->pageNum = (int32_t)pageNum;
+    r->fileId = (uint32_t)fileId;
+    r->thread = (uint32_t)tlsThread;
+    r->op = (uint32_t)op;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+RC drainAccessTrace(AccessTrace *trace) {
+    if (trace == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    int n = atomic_load(&trace->numRings);
+    if (n > TRACE_MAX_THREADS) n = TRACE_MAX_THREADS;
+    for (int i = 0; i < n; i++) {
+        // a thread that has claimed a slot may not have published its ring yet
+        TraceRing *ring = atomic_load_explicit(&trace->rings[i], memory_order_acquire);
+        if (ring == NULL) continue;
+        RC rc = writeRing(trace, ring);
+        if (rc != RC_OK) return rc;
+    }
+    return (fflush(trace->out) == 0) ? RC_OK : RC_WRITE_FAILED;
+}
+
+RC closeAccessTrace(AccessTrace *trace) {
+    if (trace == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    RC rc = drainAccessTrace(trace);
+    if (fclose(trace->out) != 0 && rc == RC_OK) rc = RC_WRITE_FAILED;
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        TraceRing *ring = atomic_load(&trace->rings[i]);
+        if (ring == NULL) continue;
+        free(ring->slots);
+        free(ring);
+    }
+    free(trace);
+    return rc;
+}
+
+unsigned long long getTraceDropped(AccessTrace *trace) {
+    return (trace == NULL) ? 0ULL : atomic_load(&trace->dropped);
+}
+
+RC readTraceFile(const char *fileName, TraceRecord **records, long *numRecords) {
+    if (fileName == NULL || records == NULL || numRecords == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    FILE *f = fopen(fileName, "rb");
+    if (f == NULL) return RC_FILE_NOT_FOUND;
+
+    char magic[8];
+    uint32_t version, recordBytes;
+    if (fread(magic, 1, 8, f) != 8 || memcmp(magic, TRACE_MAGIC, 8) != 0
+        || fread(&version, 4, 1, f) != 1 || fread(&recordBytes, 4, 1, f) != 1
+        || version != TRACE_VERSION || recordBytes != sizeof(TraceRecord)) {
+        fclose(f);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long n = (ftell(f) - TRACE_HEADER_BYTES) / (long)sizeof(TraceRecord);
+    fseek(f, TRACE_HEADER_BYTES, SEEK_SET);
+    TraceRecord *buf = (TraceRecord*)malloc(sizeof(TraceRecord) * (n > 0 ? n : 1));
+    if (buf == NULL) {
+        fclose(f);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if ((long)fread(buf, sizeof(TraceRecord), n, f) != n) {
+        free(buf);
+        fclose(f);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    fclose(f);
+    *records = buf;
+    *numRecords = n;
+    return RC_OK;
+}
@@ -0,0 +1,43 @@
+#ifndef ACCESS_TRACE_H
+#define ACCESS_TRACE_H
+
+#include <stdint.h>
+
+#include "dberror.h"
+
+// Binary access traces: a file header followed by fixed-size TraceRecords,
+// in the order the per-thread rings were drained (sort by tsNs to interleave threads)
+#define TRACE_MAGIC "BMTRACE1"
+#define TRACE_VERSION 2
+#define TRACE_MAX_THREADS 256
+
+typedef enum TraceOp {
+	TRACE_PIN = 0,
+	TRACE_UNPIN = 1,
+	TRACE_MARK_DIRTY = 2
+} TraceOp;
+
+typedef struct TraceRecord {
+	uint64_t tsNs;     // monotonic clock
+	int32_t pageNum;
+	uint32_t fileId;
+	uint32_t thread;   // index of the recording thread's ring
+	uint32_t op;       // TraceOp
+} TraceRecord;         // 24 bytes, no padding
+
+typedef struct AccessTrace AccessTrace;
+
+// ringRecords is rounded up to a power of two; each recording thread gets its own ring
+RC openAccessTrace (AccessTrace **trace, const char *fileName, int ringRecords);
+// lock-free; drops the record (and counts it) when the caller's ring is full
+void traceAccess (AccessTrace *trace, TraceOp op, int fileId, int pageNum);
+// appends everything recorded so far to the file; one drainer at a time
+RC drainAccessTrace (AccessTrace *trace);
+// drains and closes; no thread may still be recording
+RC closeAccessTrace (AccessTrace *trace);
+unsigned long long getTraceDropped (AccessTrace *trace);
+
+// loads a whole trace file; *records is malloc'd, caller frees
+RC readTraceFile (const char *fileName, TraceRecord **records, long *numRecords);
+
+#endif
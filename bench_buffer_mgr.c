@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+#include "latency_hist.h"
+#include "workload.h"
+#include "dberror.h"
+
+// Micro-benchmarks of the buffer pool hot paths, one JSON object per (case, strategy, size).
+//
+//   bench.exe [rounds]
+//
+// Hits, unpins and markDirty are cheap, alone and in pinPages/unpinPages batches, so they
+// are timed in batches over every frame of a full pool. Misses and flushes do I/O and are
+// timed one call at a time. The workload cases run generated reference streams (workload.h)
+// and also report the hit ratio.
+
+#define BENCH_FILE "bench.bin"
+#define APPEND_FILE "bench_append.bin"
+#define DEFAULT_ROUNDS 20
+#define BATCH 16 // pages per pinPages call, about one index range scan step
+
+static const char *strategyNames[] = {"FIFO", "LRU", "CLOCK", "LFU", "LRU-K"};
+static const int poolSizes[] = {16, 256, 4096};
+#define NUM_SIZES ((int)(sizeof(poolSizes) / sizeof(poolSizes[0])))
+
+static int firstResult = 1;
+
+static void report(const char *name, ReplacementStrategy strat, int frames, uint64_t ops, uint64_t ns) {
+    printf("%s\n    {\"case\": \"%s\", \"strategy\": \"%s\", \"frames\": %d, \"ops\": %llu, \"ns_per_op\": %.1f}",
+           firstResult ? "" : ",", name, strategyNames[strat], frames,
+           (unsigned long long)ops, ops ? (double)ns / (double)ops : 0.0);
+    firstResult = 0;
+}
+
+static void reportWorkload(const char *name, ReplacementStrategy strat, int frames, uint64_t ops,
+                           uint64_t ns, double hitRatio) {
+    printf("%s\n    {\"case\": \"%s\", \"strategy\": \"%s\", \"frames\": %d, \"ops\": %llu, \"ns_per_op\": %.1f, \"hit_ratio\": %.4f}",
+           firstResult ? "" : ",", name, strategyNames[strat], frames,
+           (unsigned long long)ops, ops ? (double)ns / (double)ops : 0.0, hitRatio);
+    firstResult = 0;
+}
+
+static void die(const char *what, RC rc) {
+    fprintf(stderr, "bench: %s failed (rc %d)\n", what, rc);
+    exit(1);
+}
+
+// pool of frames frames over a file of 2 * frames pages, pages [0, frames) resident
+static void openPool(BM_BufferPool *bm, ReplacementStrategy strat, int frames) {
+    RC rc = initBufferPool(bm, BENCH_FILE, frames, strat, NULL);
+    if (rc != RC_OK) die("initBufferPool", rc);
+    BM_PageHandle h;
+    memset(&h, 0, sizeof(h));
+    for (int p = 0; p < frames; p++) {
+        if ((rc = pinPage(bm, &h, p)) != RC_OK) die("pinPage", rc);
+        if ((rc = unpinPage(bm, &h)) != RC_OK) die("unpinPage", rc);
+    }
+}
+
+// pin-hit, markDirty and unpin over a resident pool: pin all, dirty all, unpin all
+static void benchHitPath(ReplacementStrategy strat, int frames, int rounds) {
+    BM_BufferPool bm;
+    BM_PageHandle *h = (BM_PageHandle*)malloc(sizeof(BM_PageHandle) * frames);
+    PageNumber *pages = (PageNumber*)malloc(sizeof(PageNumber) * frames);
+    uint64_t pinNs = 0, dirtyNs = 0, unpinNs = 0, batchPinNs = 0, batchUnpinNs = 0, t0;
+    if (h == NULL || pages == NULL) die("malloc", RC_FILE_HANDLE_NOT_INIT);
+    for (int p = 0; p < frames; p++) pages[p] = p;
+
+    openPool(&bm, strat, frames);
+    for (int r = 0; r < rounds; r++) {
+        t0 = lhNowNs();
+        for (int p = 0; p < frames; p++) (void)pinPage(&bm, &h[p], p);
+        pinNs += lhNowNs() - t0;
+
+        t0 = lhNowNs();
+        for (int p = 0; p < frames; p++) (void)markDirty(&bm, &h[p]);
+        dirtyNs += lhNowNs() - t0;
+
+        t0 = lhNowNs();
+        for (int p = 0; p < frames; p++) (void)unpinPage(&bm, &h[p]);
+        unpinNs += lhNowNs() - t0;
+
+        // the same pages in calls of BATCH
+        t0 = lhNowNs();
+        for (int p = 0; p < frames; p += BATCH)
+            (void)pinPages(&bm, &h[p], &pages[p], (frames - p < BATCH) ? frames - p : BATCH);
+        batchPinNs += lhNowNs() - t0;
+
+        t0 = lhNowNs();
+        for (int p = 0; p < frames; p += BATCH)
+            (void)unpinPages(&bm, &h[p], (frames - p < BATCH) ? frames - p : BATCH);
+        batchUnpinNs += lhNowNs() - t0;
+    }
+    uint64_t ops = (uint64_t)rounds * frames;
+    report("pin-hit", strat, frames, ops, pinNs);
+    report("markDirty", strat, frames, ops, dirtyNs);
+    report("unpin", strat, frames, ops, unpinNs);
+    report("pinPages-hit-x16", strat, frames, ops, batchPinNs);
+    report("unpinPages-x16", strat, frames, ops, batchUnpinNs);
+
+    (void)shutdownBufferPool(&bm);
+    free(pages);
+    free(h);
+}
+
+// every pin misses by cycling over twice as many pages as frames; dirty makes every victim dirty
+static void benchMiss(ReplacementStrategy strat, int frames, int rounds, int dirty) {
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    uint64_t ns = 0, ops = 0;
+    memset(&h, 0, sizeof(h));
+
+    openPool(&bm, strat, frames);
+    if (dirty) {
+        // the resident pages are the first victims; make them dirty too
+        for (int p = 0; p < frames; p++) {
+            (void)pinPage(&bm, &h, p);
+            (void)markDirty(&bm, &h);
+            (void)unpinPage(&bm, &h);
+        }
+    }
+    int span = 2 * frames;
+    int next = frames;
+    // pinning pages in ascending order over a span of 2*frames keeps every policy missing
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < frames; i++) {
+            uint64_t t0 = lhNowNs();
+            RC rc = pinPage(&bm, &h, next);
+            ns += lhNowNs() - t0;
+            if (rc != RC_OK) die("pinPage", rc);
+            if (dirty) (void)markDirty(&bm, &h);
+            (void)unpinPage(&bm, &h);
+            next = (next + 1) % span;
+            ops++;
+        }
+    }
+    report(dirty ? "pin-miss-dirty" : "pin-miss-clean", strat, frames, ops, ns);
+    (void)shutdownBufferPool(&bm);
+}
+
+static void benchFlush(ReplacementStrategy strat, int frames, int rounds) {
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    uint64_t ns = 0;
+    memset(&h, 0, sizeof(h));
+
+    openPool(&bm, strat, frames);
+    for (int r = 0; r < rounds; r++) {
+        for (int p = 0; p < frames; p++) {
+            (void)pinPage(&bm, &h, p);
+            (void)markDirty(&bm, &h);
+            (void)unpinPage(&bm, &h);
+        }
+        uint64_t t0 = lhNowNs();
+        RC rc = forceFlushPool(&bm);
+        ns += lhNowNs() - t0;
+        if (rc != RC_OK) die("forceFlushPool", rc);
+    }
+    report("forceFlushPool", strat, frames, (uint64_t)rounds, ns);
+    (void)shutdownBufferPool(&bm);
+}
+
+// grow an empty file by rounds * frames pages, each filled and released; flushed at the end
+static void benchAppend(ReplacementStrategy strat, int frames, int rounds, int useNewPage) {
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    PageNumber p;
+    RC rc;
+    memset(&h, 0, sizeof(h));
+
+    if ((rc = createPageFile(APPEND_FILE)) != RC_OK) die("createPageFile", rc);
+    if ((rc = initBufferPool(&bm, APPEND_FILE, frames, strat, NULL)) != RC_OK) die("initBufferPool", rc);
+    long ops = (long)rounds * frames;
+    uint64_t t0 = lhNowNs();
+    for (long i = 0; i < ops; i++) {
+        rc = useNewPage ? pinNewPage(&bm, &h, &p) : pinPage(&bm, &h, (PageNumber)(i + 1));
+        if (rc != RC_OK) die("append", rc);
+        h.data[0] = 'x';
+        if (!useNewPage) (void)markDirty(&bm, &h);
+        (void)unpinPage(&bm, &h);
+    }
+    if ((rc = forceFlushPool(&bm)) != RC_OK) die("forceFlushPool", rc);
+    report(useNewPage ? "append-pinNewPage" : "append-pinPage", strat, frames, (uint64_t)ops, lhNowNs() - t0);
+    (void)shutdownBufferPool(&bm);
+    (void)destroyPageFile(APPEND_FILE);
+}
+
+// a pool of frames frames over a file of 16 * frames pages
+static void benchWorkload(const char *name, WorkloadSpec spec, ReplacementStrategy strat, int frames, long accesses) {
+    BM_BufferPool bm;
+    Workload wl;
+    BM_Stats stats;
+
+    spec.numPages = 16 * frames;
+    RC rc = initWorkload(&wl, &spec);
+    if (rc != RC_OK) die("initWorkload", rc);
+    if ((rc = initBufferPool(&bm, BENCH_FILE, frames, strat, NULL)) != RC_OK) die("initBufferPool", rc);
+    uint64_t t0 = lhNowNs();
+    if ((rc = runWorkload(&bm, &wl, accesses)) != RC_OK) die("runWorkload", rc);
+    uint64_t ns = lhNowNs() - t0;
+    (void)getPoolStats(&bm, &stats);
+    reportWorkload(name, strat, frames, (uint64_t)accesses, ns,
+                   (double)stats.hits / (double)(stats.hits + stats.misses));
+    (void)shutdownBufferPool(&bm);
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = (argc > 1) ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    if (rounds <= 0) rounds = DEFAULT_ROUNDS;
+
+    RC rc = createPageFile(BENCH_FILE);
+    if (rc != RC_OK) die("createPageFile", rc);
+
+    printf("{\n  \"benchmark\": \"buffer_mgr\",\n  \"page_size\": %d,\n  \"rounds\": %d,\n  \"results\": [",
+           PAGE_SIZE, rounds);
+    for (int s = 0; s < NUM_SIZES; s++) {
+        for (int strat = RS_FIFO; strat <= RS_LRU_K; strat++) {
+            // misses and flushes cost I/O per frame; fewer rounds keep big pools quick
+            int ioRounds = (poolSizes[s] >= 1024) ? 1 : rounds / 4 + 1;
+            benchHitPath((ReplacementStrategy)strat, poolSizes[s], rounds);
+            benchMiss((ReplacementStrategy)strat, poolSizes[s], ioRounds, 0);
+            benchMiss((ReplacementStrategy)strat, poolSizes[s], ioRounds, 1);
+            benchFlush((ReplacementStrategy)strat, poolSizes[s], ioRounds);
+            benchAppend((ReplacementStrategy)strat, poolSizes[s], ioRounds, 0);
+            benchAppend((ReplacementStrategy)strat, poolSizes[s], ioRounds, 1);
+        }
+    }
+
+    const int frames = 256;
+    const long accesses = 2000L * rounds;
+    WorkloadSpec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.seed = 42;
+    spec.writeRatio = 0.2;
+    for (int strat = RS_FIFO; strat <= RS_LRU_K; strat++) {
+        spec.kind = WL_ZIPFIAN;
+        spec.theta = 0.99;
+        benchWorkload("zipfian-0.99", spec, (ReplacementStrategy)strat, frames, accesses);
+        spec.kind = WL_LOOP_SCAN;
+        spec.loopPages = frames + frames / 4;
+        benchWorkload("loop-scan-1.25x", spec, (ReplacementStrategy)strat, frames, accesses);
+        spec.kind = WL_HOTSET_SHIFT;
+        spec.hotPages = frames / 2;
+        spec.hotFraction = 0.9;
+        spec.shiftEvery = accesses / 8;
+        benchWorkload("hotset-shift", spec, (ReplacementStrategy)strat, frames, accesses);
+        spec.kind = WL_TPCC;
+        benchWorkload("tpcc-mix", spec, (ReplacementStrategy)strat, frames, accesses);
+    }
+    printf("\n  ]\n}\n");
+
+    (void)destroyPageFile(BENCH_FILE);
+    return 0;
+}
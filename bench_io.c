@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "storage_mgr.h"
+#include "latency_hist.h"
+#include "dberror.h"
+#include "dt.h"
+
+// Storage manager I/O benchmark: readBlock, writeBlock, the vectored readBlocks/writeBlocks,
+// appendEmptyBlock and ensureCapacity, sequential vs random, through the page cache vs O_DIRECT.
+// One JSON object per case; ops are pages, so batched and single-page cases compare directly.
+//
+//   bench_io.exe [pages]
+//
+// The Makefile links this binary with -Wl,--wrap for open/close/read/write/lseek and the
+// positional pread/pwrite/preadv/pwritev, so every syscall storage_manager.c makes passes
+// through the counters below.
+
+#define BENCH_FILE "bench_io.bin"
+#define DEFAULT_PAGES 4096
+#define BATCH 16 // pages per readBlocks/writeBlocks call, as in the pool's pinPages benchmark
+
+enum { SC_OPEN, SC_CLOSE, SC_READ, SC_WRITE, SC_LSEEK, SC_PREAD, SC_PWRITE, SC_NUM }; // preadv/pwritev count as pread/pwrite
+static unsigned long long syscalls[SC_NUM];
+
+int __real_open(const char *path, int flags, ...);
+int __real_close(int fd);
+ssize_t __real_read(int fd, void *buf, size_t n);
+ssize_t __real_write(int fd, const void *buf, size_t n);
+off_t __real_lseek(int fd, off_t off, int whence);
+ssize_t __real_pread(int fd, void *buf, size_t n, off_t off);
+ssize_t __real_pwrite(int fd, const void *buf, size_t n, off_t off);
+ssize_t __real_preadv(int fd, const struct iovec *iov, int iovcnt, off_t off);
+ssize_t __real_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t off);
+
+int __wrap_open(const char *path, int flags, ...) {
+    mode_t mode = 0;
+    if (flags & O_CREAT) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = (mode_t)va_arg(ap, int);
+        va_end(ap);
+    }
+    syscalls[SC_OPEN]++;
+    return __real_open(path, flags, mode);
+}
+
+int __wrap_close(int fd) {
+    syscalls[SC_CLOSE]++;
+    return __real_close(fd);
+}
+
+ssize_t __wrap_read(int fd, void *buf, size_t n) {
+    syscalls[SC_READ]++;
+    return __real_read(fd, buf, n);
+}
+
+ssize_t __wrap_write(int fd, const void *buf, size_t n) {
+    syscalls[SC_WRITE]++;
+    return __real_write(fd, buf, n);
+}
+
+off_t __wrap_lseek(int fd, off_t off, int whence) {
+    syscalls[SC_LSEEK]++;
+    return __real_lseek(fd, off, whence);
+}
+
+ssize_t __wrap_pread(int fd, void *buf, size_t n, off_t off) {
+    syscalls[SC_PREAD]++;
+    return __real_pread(fd, buf, n, off);
+}
+
+ssize_t __wrap_pwrite(int fd, const void *buf, size_t n, off_t off) {
+    syscalls[SC_PWRITE]++;
+    return __real_pwrite(fd, buf, n, off);
+}
+
+ssize_t __wrap_preadv(int fd, const struct iovec *iov, int iovcnt, off_t off) {
+    syscalls[SC_PREAD]++;
+    return __real_preadv(fd, iov, iovcnt, off);
+}
+
+ssize_t __wrap_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t off) {
+    syscalls[SC_PWRITE]++;
+    return __real_pwritev(fd, iov, iovcnt, off);
+}
+
+typedef struct Probe { // syscall counts and clock at the start of a measured run
+    unsigned long long calls[SC_NUM];
+    uint64_t t0;
+} Probe;
+
+static int firstResult = 1;
+
+static void die(const char *what, RC rc) {
+    fprintf(stderr, "bench_io: %s failed (rc %d)\n", what, rc);
+    exit(1);
+}
+
+static void startProbe(Probe *p) {
+    memcpy(p->calls, syscalls, sizeof(syscalls));
+    p->t0 = lhNowNs();
+}
+
+static void report(const Probe *p, const char *name, const char *mode, const char *pattern, long ops, long pages) {
+    uint64_t ns = lhNowNs() - p->t0;
+    unsigned long long d[SC_NUM], total = 0;
+    for (int i = 0; i < SC_NUM; i++) {
+        d[i] = syscalls[i] - p->calls[i];
+        total += d[i];
+    }
+    double per = (ops > 0) ? 1.0 / (double)ops : 0.0;
+    printf("%s\n    {\"case\": \"%s\", \"mode\": \"%s\", \"pattern\": \"%s\", \"ops\": %ld, \"ns_per_op\": %.1f, "
+           "\"mb_per_sec\": %.1f, \"syscalls_per_op\": %.2f, \"read_per_op\": %.2f, \"write_per_op\": %.2f, "
+           "\"lseek_per_op\": %.2f, \"pread_per_op\": %.2f, \"pwrite_per_op\": %.2f}",
+           firstResult ? "" : ",", name, mode, pattern, ops, (double)ns * per,
+           ns ? (double)pages * PAGE_SIZE * 1e3 / (double)ns : 0.0,
+           (double)total * per, (double)d[SC_READ] * per, (double)d[SC_WRITE] * per, (double)d[SC_LSEEK] * per,
+           (double)d[SC_PREAD] * per, (double)d[SC_PWRITE] * per);
+    firstResult = 0;
+}
+
+static void shuffle(int *order, int n) { // fixed seed, so both modes see the same random order
+    unsigned long long x = 88172645463325252ULL;
+    for (int i = 0; i < n; i++) order[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        int j = (int)(x % (unsigned long long)(i + 1));
+        int t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+}
+
+// returns FALSE when the mode is not available on this file system
+static bool benchMode(const char *mode, bool direct, int pages, const int *order, SM_PageHandle buf,
+                      SM_PageHandle *batch) {
+    SM_FileHandle fh;
+    Probe p;
+    RC rc;
+    int runs = pages / BATCH; // whole batches only; order[] of the first runs entries picks random ones
+
+    if ((rc = createPageFile(BENCH_FILE)) != RC_OK) die("createPageFile", rc);
+    rc = direct ? openPageFileDirect(BENCH_FILE, &fh) : openPageFile(BENCH_FILE, &fh);
+    if (rc != RC_OK) {
+        (void)destroyPageFile(BENCH_FILE);
+        return FALSE;
+    }
+
+    startProbe(&p);
+    if ((rc = ensureCapacity(pages, &fh)) != RC_OK) die("ensureCapacity", rc);
+    report(&p, "ensureCapacity", mode, "bulk", pages - 1, pages - 1);
+
+    startProbe(&p);
+    for (int i = 0; i < pages; i++)
+        if ((rc = writeBlock(i, &fh, buf)) != RC_OK) die("writeBlock", rc);
+    report(&p, "writeBlock", mode, "sequential", pages, pages);
+
+    startProbe(&p);
+    for (int i = 0; i < pages; i++)
+        if ((rc = writeBlock(order[i], &fh, buf)) != RC_OK) die("writeBlock", rc);
+    report(&p, "writeBlock", mode, "random", pages, pages);
+
+    startProbe(&p);
+    for (int i = 0; i < pages; i++)
+        if ((rc = readBlock(i, &fh, buf)) != RC_OK) die("readBlock", rc);
+    report(&p, "readBlock", mode, "sequential", pages, pages);
+
+    startProbe(&p);
+    for (int i = 0; i < pages; i++)
+        if ((rc = readBlock(order[i], &fh, buf)) != RC_OK) die("readBlock", rc);
+    report(&p, "readBlock", mode, "random", pages, pages);
+
+    // the pool's batched paths: one positional vectored call per BATCH consecutive pages
+    startProbe(&p);
+    for (int r = 0; r < runs; r++)
+        if ((rc = writeBlocks(r * BATCH, BATCH, &fh, batch)) != RC_OK) die("writeBlocks", rc);
+    report(&p, "writeBlocks", mode, "sequential", (long)runs * BATCH, (long)runs * BATCH);
+
+    startProbe(&p);
+    for (int i = 0, r = 0; i < pages && r < runs; i++) {
+        if (order[i] >= runs) continue;
+        if ((rc = writeBlocks(order[i] * BATCH, BATCH, &fh, batch)) != RC_OK) die("writeBlocks", rc);
+        r++;
+    }
+    report(&p, "writeBlocks", mode, "random", (long)runs * BATCH, (long)runs * BATCH);
+
+    startProbe(&p);
+    for (int r = 0; r < runs; r++)
+        if ((rc = readBlocks(r * BATCH, BATCH, &fh, batch)) != RC_OK) die("readBlocks", rc);
+    report(&p, "readBlocks", mode, "sequential", (long)runs * BATCH, (long)runs * BATCH);
+
+    startProbe(&p);
+    for (int i = 0, r = 0; i < pages && r < runs; i++) {
+        if (order[i] >= runs) continue;
+        if ((rc = readBlocks(order[i] * BATCH, BATCH, &fh, batch)) != RC_OK) die("readBlocks", rc);
+        r++;
+    }
+    report(&p, "readBlocks", mode, "random", (long)runs * BATCH, (long)runs * BATCH);
+
+    int grow = pages / 4 > 0 ? pages / 4 : 1;
+    startProbe(&p);
+    for (int i = 0; i < grow; i++)
+        if ((rc = appendEmptyBlock(&fh)) != RC_OK) die("appendEmptyBlock", rc);
+    report(&p, "appendEmptyBlock", mode, "sequential", grow, grow);
+
+    // the buffer pool's pattern: grow by one page to reach a page just past the end
+    startProbe(&p);
+    for (int i = 0; i < grow; i++)
+        if ((rc = ensureCapacity(fh.totalNumPages + 1, &fh)) != RC_OK) die("ensureCapacity", rc);
+    report(&p, "ensureCapacity", mode, "one-page", grow, grow);
+
+    (void)closePageFile(&fh);
+    (void)destroyPageFile(BENCH_FILE);
+    return TRUE;
+}
+
+int main(int argc, char *argv[]) {
+    int pages = (argc > 1) ? atoi(argv[1]) : DEFAULT_PAGES;
+    if (pages <= 1) pages = DEFAULT_PAGES;
+
+    int *order = (int*)malloc(sizeof(int) * pages);
+    void *mem = NULL, *batchMem = NULL;
+    if (order == NULL || posix_memalign(&mem, PAGE_SIZE, PAGE_SIZE) != 0
+        || posix_memalign(&batchMem, PAGE_SIZE, (size_t)BATCH * PAGE_SIZE) != 0) die("malloc", RC_FILE_HANDLE_NOT_INIT);
+    SM_PageHandle buf = (SM_PageHandle)mem;
+    memset(buf, 'x', PAGE_SIZE);
+    memset(batchMem, 'y', (size_t)BATCH * PAGE_SIZE);
+    SM_PageHandle batch[BATCH];
+    for (int i = 0; i < BATCH; i++) batch[i] = (SM_PageHandle)batchMem + (size_t)i * PAGE_SIZE;
+    shuffle(order, pages);
+
+    printf("{\n  \"benchmark\": \"storage_mgr\",\n  \"page_size\": %d,\n  \"pages\": %d,\n  \"results\": [",
+           PAGE_SIZE, pages);
+    (void)benchMode("buffered", FALSE, pages, order, buf, batch);
+    bool direct = benchMode("direct", TRUE, pages, order, buf, batch);
+    printf("\n  ],\n  \"o_direct_supported\": %s\n}\n", direct ? "true" : "false");
+
+    free(mem);
+    free(batchMem);
+    free(order);
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+#include "latency_hist.h"
+#include "workload.h"
+#include "dberror.h"
+
+// Scalability of one concurrent pool from 1 to 64 threads, one JSON object per (case, strategy, threads).
+//
+//   bench_mt.exe [accesses per thread]
+//
+// Every thread runs its own generator (same shape, different seed) against the shared pool,
+// so the work per thread is fixed and ideal scaling keeps per-thread throughput flat.
+// Each access (pin, unpin) is timed into the thread's own histogram; the clock reads are
+// part of the measured throughput.
+
+#define BENCH_FILE "bench_mt.bin"
+#define DEFAULT_ACCESSES 20000L
+#define FRAMES 1024
+
+static const char *strategyNames[] = {"FIFO", "LRU", "CLOCK", "LFU", "LRU-K"};
+static const int threadCounts[] = {1, 2, 4, 8, 16, 32, 64};
+#define NUM_COUNTS ((int)(sizeof(threadCounts) / sizeof(threadCounts[0])))
+
+typedef struct Worker {
+    pthread_t thread;
+    BM_BufferPool *bm;
+    pthread_barrier_t *start;
+    Workload wl;
+    long accesses;
+    uint64_t ns;  // this thread's own wall time
+    LatencyHist lat;
+    RC rc;
+} Worker;
+
+static int firstResult = 1;
+
+static void die(const char *what, RC rc) {
+    fprintf(stderr, "bench_mt: %s failed (rc %d)\n", what, rc);
+    exit(1);
+}
+
+static void *runWorker(void *arg) {
+    Worker *w = (Worker*)arg;
+    pthread_barrier_wait(w->start);
+    uint64_t t0 = lhNowNs();
+    BM_PageHandle h;
+    PageNumber p;
+    bool write;
+    memset(&h, 0, sizeof(h));
+    for (long i = 0; i < w->accesses && w->rc == RC_OK; i++) {
+        // runWorkload's loop, with every access timed
+        nextAccess(&w->wl, &p, &write);
+        uint64_t a0 = lhNowNs();
+        w->rc = pinPage(w->bm, &h, p);
+        if (w->rc == RC_OK) w->rc = unpinPageDirty(w->bm, &h, write);
+        lhRecord(&w->lat, lhNowNs() - a0);
+    }
+    w->ns = lhNowNs() - t0;
+    return NULL;
+}
+
+static void printThreadPercentiles(const char *key, Worker *workers, int threads, double q) {
+    printf(", \"%s\": [", key);
+    for (int t = 0; t < threads; t++) {
+        printf("%s%llu", t ? ", " : "", (unsigned long long)lhPercentile(&workers[t].lat, q));
+    }
+    printf("]");
+}
+
+static void benchThreads(const char *name, const WorkloadSpec *spec, ReplacementStrategy strat, int threads,
+                         long accesses) {
+    BM_BufferPool bm;
+    BM_PoolOptions opts;
+    BM_Stats stats;
+    pthread_barrier_t start;
+    Worker *workers = (Worker*)calloc(threads, sizeof(Worker));
+    if (workers == NULL) die("calloc", RC_FILE_HANDLE_NOT_INIT);
+
+    memset(&opts, 0, sizeof(opts));
+    opts.concurrent = TRUE;
+    RC rc = initBufferPoolWithOptions(&bm, BENCH_FILE, FRAMES, strat, NULL, &opts);
+    if (rc != RC_OK) die("initBufferPoolWithOptions", rc);
+
+    // warm the pool so every thread count starts from the same state
+    Workload warm;
+    WorkloadSpec warmSpec = *spec;
+    warmSpec.seed = 1;
+    if ((rc = initWorkload(&warm, &warmSpec)) != RC_OK) die("initWorkload", rc);
+    if ((rc = runWorkload(&bm, &warm, 4 * FRAMES)) != RC_OK) die("runWorkload", rc);
+    (void)resetPoolStats(&bm);
+
+    pthread_barrier_init(&start, NULL, (unsigned)threads + 1);
+    for (int t = 0; t < threads; t++) {
+        WorkloadSpec s = *spec;
+        s.seed = spec->seed + 1000003ULL * (unsigned long long)(t + 1);
+        if ((rc = initWorkload(&workers[t].wl, &s)) != RC_OK) die("initWorkload", rc);
+        workers[t].bm = &bm;
+        workers[t].start = &start;
+        workers[t].accesses = accesses;
+        lhReset(&workers[t].lat);
+        if (pthread_create(&workers[t].thread, NULL, runWorker, &workers[t]) != 0) die("pthread_create", RC_FILE_HANDLE_NOT_INIT);
+    }
+    pthread_barrier_wait(&start);
+    uint64_t t0 = lhNowNs();
+    for (int t = 0; t < threads; t++) pthread_join(workers[t].thread, NULL);
+    uint64_t wall = lhNowNs() - t0;
+    pthread_barrier_destroy(&start);
+
+    double minRate = 0.0, maxRate = 0.0;
+    LatencyHist all;
+    lhReset(&all);
+    for (int t = 0; t < threads; t++) {
+        if (workers[t].rc != RC_OK) die("worker", workers[t].rc);
+        lhMerge(&all, &workers[t].lat);
+        double rate = (double)accesses * 1e9 / (double)(workers[t].ns ? workers[t].ns : 1);
+        if (t == 0 || rate < minRate) minRate = rate;
+        if (t == 0 || rate > maxRate) maxRate = rate;
+    }
+    (void)getPoolStats(&bm, &stats);
+    double ops = (double)accesses * threads;
+
+    printf("%s\n    {\"case\": \"%s\", \"strategy\": \"%s\", \"threads\": %d, \"ops\": %.0f, \"seconds\": %.4f, "
+           "\"mops_per_sec\": %.3f, \"thread_min_ops_per_sec\": %.0f, \"thread_max_ops_per_sec\": %.0f, "
+           "\"hit_ratio\": %.4f, \"latch_contended_pct\": %.2f, \"latch_wait_ns_per_op\": %.1f, "
+           "\"p50_ns\": %llu, \"p99_ns\": %llu",
+           firstResult ? "" : ",", name, strategyNames[strat], threads, ops, (double)wall / 1e9,
+           ops * 1e3 / (double)wall, minRate, maxRate,
+           (double)stats.hits / (double)(stats.hits + stats.misses ? stats.hits + stats.misses : 1),
+           stats.latchAcquires ? 100.0 * (double)stats.latchContended / (double)stats.latchAcquires : 0.0,
+           (double)stats.latchWaitNs / ops, (unsigned long long)lhPercentile(&all, 0.50),
+           (unsigned long long)lhPercentile(&all, 0.99));
+    printThreadPercentiles("thread_p50_ns", workers, threads, 0.50);
+    printThreadPercentiles("thread_p99_ns", workers, threads, 0.99);
+    printf("}");
+    firstResult = 0;
+
+    (void)shutdownBufferPool(&bm);
+    free(workers);
+}
+
+int main(int argc, char *argv[]) {
+    long accesses = (argc > 1) ? atol(argv[1]) : DEFAULT_ACCESSES;
+    if (accesses <= 0) accesses = DEFAULT_ACCESSES;
+
+    RC rc = createPageFile(BENCH_FILE);
+    if (rc != RC_OK) die("createPageFile", rc);
+
+    WorkloadSpec hit, zipf;
+    memset(&hit, 0, sizeof(hit));
+    hit.kind = WL_UNIFORM;
+    hit.numPages = FRAMES / 2;      // always resident: measures the latch and hit path alone
+    hit.seed = 42;
+    zipf = hit;
+    zipf.kind = WL_ZIPFIAN;
+    zipf.numPages = 16 * FRAMES;
+    zipf.theta = 0.99;
+    zipf.writeRatio = 0.2;
+
+    printf("{\n  \"benchmark\": \"buffer_mgr_mt\",\n  \"frames\": %d,\n  \"accesses_per_thread\": %ld,\n  \"results\": [",
+           FRAMES, accesses);
+    for (int strat = RS_FIFO; strat <= RS_LRU_K; strat++) {
+        for (int c = 0; c < NUM_COUNTS; c++) benchThreads("hit-only", &hit, (ReplacementStrategy)strat, threadCounts[c], accesses);
+        for (int c = 0; c < NUM_COUNTS; c++) benchThreads("zipfian-0.99", &zipf, (ReplacementStrategy)strat, threadCounts[c], accesses);
+    }
+    printf("\n  ]\n}\n");
+
+    (void)destroyPageFile(BENCH_FILE);
+    return 0;
+}
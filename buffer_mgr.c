@@ -1,94 +1,542 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
+#include "frame_arena.h"
+#include "latency_hist.h"
+#include "access_trace.h"
+#include "mrc.h"
+#include "page_table.h"
 #include "dberror.h"
 #include "dt.h"
+// Latch-free pins (concurrent mode) find a frame through the page table and raise fixCount by
+// CAS, then check the tag. The fields they read are atomic. Under the latch, a frame holding a
+// page is emptied or retagged only after claimFrame has swapped its fixCount from 0 to
+// FRAME_CLAIMED, which no latch-free pin gets past; otherwise fixCount only changes by +1/-1.
+#define FRAME_CLAIMED (-1)
+
 typedef struct Frame { // It temprorarily holds the page data in the buffer pool from the disk
-    PageNumber pageNum;     
+    _Atomic int fileId;      // with pageNum, the tag of the cached page
+    _Atomic PageNumber pageNum;
     char *data;            
     bool dirty;           
-    int  fixCount;        
+    int dirtyFrom;           // while dirty: bytes [dirtyFrom, dirtyTo) written since the last write-back
+    int dirtyTo;
+    _Atomic int fixCount;
     unsigned long long seq; 
-    unsigned long long lru; 
+    _Atomic unsigned long long lru;
+    int  node;               // NUMA node holding the frame memory, -1 when not partitioned
+    _Atomic bool loading;    // the page is being read; pins wait on PoolMgmt.loaded (warm-up) or the latch
+    _Atomic unsigned int gen; // changes whenever the frame takes a page; 0 while empty
+    bool hot;                // protected segment (AH_KEEP_HOT); a victim only when nothing else is
+    _Atomic bool prefetched; // read ahead of a scan and not pinned since
+    BM_PagePriority priority; // victims come from the lowest class that has one
+    _Atomic int swizParent;  // frame whose page holds a slot swizzled to this one, -1 when none
+    _Atomic int swizOffset;  // byte offset of that slot in the parent's page
+    int swizChildren;        // slots in this page swizzled to resident children
 } Frame;
 
+typedef struct FrameSegment { // one arena backing a contiguous run of frame indices
+    FrameArena arena;
+    int firstFrame;
+    int numSlots;
+    int node;
+} FrameSegment;
+
+#define GHOST_BUCKETS 16
+
+typedef struct Ghost { // a page evicted recently; a miss on it would have been a hit in a bigger pool
+    int fileId;
+    PageNumber pageNum;
+    unsigned long long evictNo;
+    int next;                // next ghost in the same ghostHeads chain, -1 at the end
+} Ghost;
+
+#define WARMUP_MAGIC "BMWARM01"
+#define WARMUP_SUFFIX ".warm"
+#define WARMUP_BATCH 32      // pages per vectored read
+
+typedef struct WarmEntry { // a page listed in the warm-up sidecar; rank 0 was the hottest
+    PageNumber pageNum;
+    int rank;
+} WarmEntry;
+
+#define SCAN_READAHEAD 8     // pages a scan-hinted miss reads past the requested one
+#define HOT_SEGMENT_SHARE 4  // at most 1/4 of the frames are protected
+#define HIGH_PRIORITY_SHARE 0.25 // default share of the frames for PP_HIGH pages
+
+#define PIN_BATCH_STACK 64   // pinPages entries that fit on the stack
+#define PIN_BATCH_RUN 64     // pages per vectored read of a batch
+
+typedef struct BatchPin { // one page of a pinPages call
+    PageNumber pageNum;
+    int pos;                 // index into the caller's arrays
+    int frame;               // resident or reserved frame, -1 until known
+    bool miss;               // first entry of a page that had to be loaded
+    bool read;               // its read has completed
+} BatchPin;
+
+#define FLUSH_DEPTH 32        // default pages per batch, and per vectored write, of a pool flush
+#define FLUSH_MAX_THREADS 64
+
+typedef struct FlushPage { // one frame of a forceFlushPool call, pinned by the call
+    int fileId;
+    PageNumber pageNum;
+    int frame;
+    int dirtyFrom;           // the range cleared before the write, given back if it fails
+    int dirtyTo;
+    bool write;              // still dirty when its batch began, and goes out in a vectored write
+    bool ok;
+} FlushPage;
+
+typedef struct FlushJob {
+    struct PoolMgmt *pm;
+    FlushPage *pages;        // sorted by file and page, so batches hold runs
+    int count;
+    int depth;
+    _Atomic int next;        // first page no writer has taken
+    _Atomic bool failed;     // writers stop taking batches
+    RC rc;                   // first error; under progressLock
+    uint64_t done;
+    BM_FlushProgress progress;
+    void *progressArg;
+    pthread_mutex_t lock;    // frame metadata, for pools without a latch
+    pthread_mutex_t progressLock;
+} FlushJob;
+
+typedef struct PoolFile { // a page file cached by the pool; fileId is its index
+    SM_FileHandle fh;
+    char *name;
+    bool open;
+    PageNumber nextPage;     // next page pinNewPage hands out; runs ahead of the file until write-back
+    PageNumber highPage;     // no resident page of the file is above it; -1 before the first load
+} PoolFile;
+
+typedef struct FileFrameIter { // the frames of one file holding pages in [from, to)
+    int fileId;
+    PageNumber from;
+    PageNumber to;
+    bool lookup;             // page by page through the page table, or over every frame
+    int64_t next;
+} FileFrameIter;
+
+#define STAT_SHARDS 16      // counter shards; a thread keeps to the one it was dealt
+#define FAST_TICK_EVERY 64  // latch-free hits a thread makes between advances of the pool clock
+
+typedef struct StatShard { // one thread's share of the counters, on cache lines of its own
+    BM_Stats stats;                // bumped under the latch through STAT_ADD
+    _Atomic uint64_t fastPins;     // bumped without it through FAST_COUNT
+    _Atomic uint64_t fastUnpins;
+    _Atomic uint64_t swizzledPins; // both paths
+} __attribute__((aligned(64))) StatShard;
+
+#define STAT_ADD(pm, field, n) ((pm)->shards[statShard()].stats.field += (uint64_t)(n))
+#define STAT_TOTAL(pm, field) statTotal(pm, offsetof(BM_Stats, field))
+#define FAST_COUNT(pm, field) \
+    atomic_fetch_add_explicit(&(pm)->shards[statShard()].field, 1, memory_order_relaxed)
+
+// latency probes cost one branch while tracking is off
+#define LAT_START(pm) (((pm)->latency != NULL) ? lhNowNs() : 0ULL)
+#define LAT_RECORD(pm, op, t0) \
+    do { if ((pm)->latency != NULL) lhRecord(&(pm)->latency[op], lhNowNs() - (t0)); } while (0)
+
+#define TRACE(pm, op, fileId, pageNum) \
+    do { if ((pm)->trace != NULL) traceAccess((pm)->trace, op, fileId, pageNum); } while (0)
+
 typedef struct PoolMgmt { // It tracks the file,frame,capacity and I/O results
-    SM_FileHandle fh;            
+    PoolFile *files;             // files[0] is the pool's pageFile
+    int numFiles;
     Frame *frames;              
-    int capacity;             
-    int numReadIO;               
-    int numWriteIO;             
-    unsigned long long tick;     
+    FrameSegment *segments;      // page data of the frames, one mapping per NUMA partition and growth step
+    int numSegments;
+    FrameBacking backing;        // requested backing, reused when the pool grows
+    int capacity;                // frames currently allocated
+    int target;                  // frames wanted; frames >= target drain out as they are unpinned
+    bool numa;                   // frames split into per-node partitions
+    double highShare;            // fraction of target that PP_HIGH pages may hold
+    int numNodes;
+    int nodes[MAX_NUMA_NODES];   // node id of each partition
+    LatencyHist *latency;        // one histogram per BM_LatencyOp, NULL while tracking is off
+    AccessTrace *trace;          // pin/unpin/markDirty recording, NULL while off
+    MrcSampler *mrc;             // SHARDS reuse-distance sampler, NULL while off
+    bool concurrent;             // public calls serialize on latch, except latch-free hits and unpins
+    pthread_mutex_t latch;
+    PageTable table;             // (fileId, pageNum) -> frame, for everything that used to scan the frames
+    bool fastAllowed;            // latch-free path possible: concurrent, and no tracing/sampling/latency/NUMA
+    _Atomic bool fastGate;       // latch-free path open; closed and drained while frames move
+    StatShard shards[STAT_SHARDS]; // counters behind getPoolStats, summed as they are read
+    pthread_cond_t loaded;       // broadcast as warm-up batches land
+    bool warmup;                 // write the sidecar on shutdown
+    char *warmName;              // <pageFile>.warm
+    WarmEntry *warmList;         // pages left for the warm-up thread, by page number
+    int warmCount;
+    bool warmRunning;            // waitForWarmup blocks while set
+    bool warmStop;               // shutdown asks the warm-up thread to quit after its batch
+    bool warmStarted;            // warmThread needs a join
+    pthread_t warmThread;
+    _Atomic unsigned long long tick;
+    unsigned int nextGen;        // last frame generation handed out
+    Ghost *ghosts;               // ring of the last ghostCap evictions, NULL when disabled
+    int ghostCap;
+    int *ghostHeads;             // hash chains over the live ghosts, by (fileId, pageNum)
+    uint64_t ghostMask;          // chain count - 1
+    unsigned long long evictions;
+    unsigned long long ghostHist[GHOST_BUCKETS]; // ghost hits by eviction distance
 } PoolMgmt;
 
 static PoolMgmt *mgmt(BM_BufferPool *const bm);// get PoolMgmt struct from BM_BufferPool
-static int findFrameIndexByPage(PoolMgmt *pm, PageNumber p);//  find the index of a frame that holds the given page
-static int findEmptyFrameIndex(PoolMgmt *pm);//find an unused (empty) frame index
-static int pickVictim(PoolMgmt *pm, ReplacementStrategy strat); //choose a frame to remove based on FIFO/LRU
-static RC evictIfNeededAndLoad(PoolMgmt *pm, int fidx, PageNumber pageNum);//remove old page (if needed) and load a new one into frame
+static int findFrameIndexByPage(PoolMgmt *pm, int fileId, PageNumber p);//  find the index of a frame that holds the given page
+static int frameOfHandle(PoolMgmt *pm, BM_PageHandle *page, int fileId);// frame named by a pinned handle, else lookup
+static RC tagFrame(PoolMgmt *pm, Frame *fr, int fileId, PageNumber p);// empty frame now holds (fileId, p), new generation, in the page table
+static bool claimFrame(Frame *fr);// fixCount 0 -> FRAME_CLAIMED; fails while any pin is held
+static void claimFrameWait(Frame *fr);// claim a frame whose only other pins are latch-free ones backing off
+static void unfixFrame(Frame *fr);// drop one pin, never below zero
+static void clearFrame(PoolMgmt *pm, Frame *fr);// claimed frame leaves the page table and becomes empty
+static bool claimFileFrames(PoolMgmt *pm, int fileId, PageNumber from, PageNumber to);// claim every frame of the file in [from, to), or none
+static bool pauseFastPath(PoolMgmt *pm);// close the latch-free path and wait for it to drain; returns whether it was open
+static void resumeFastPath(PoolMgmt *pm, bool wasOpen);
+static void updateFastPath(PoolMgmt *pm);// open or close the latch-free path after a setting changed
+static bool pinLatchFree(PoolMgmt *pm, BM_PageHandle *page, int fileId, PageNumber pageNum);// hit without the latch
+static bool unpinLatchFree(PoolMgmt *pm, BM_PageHandle *page, int fileId);
+static int findEmptyFrameIndex(PoolMgmt *pm, int node);//find an unused (empty) frame index, on node unless node < 0
+static int pickVictim(PoolMgmt *pm, ReplacementStrategy strat, int node); //choose a frame to remove based on FIFO/LRU
+static RC evictIfNeededAndLoad(PoolMgmt *pm, int fidx, int fileId, PageNumber pageNum);//remove old page (if needed) and load a new one into frame
 static RC flushFrameIfDirty(PoolMgmt *pm, Frame *fr);// write frame back to disk if it’s dirty
+static char *diskImage(PoolMgmt *pm, Frame *fr, char *scratch);// the page as it goes to disk, copied into scratch if it differs
+static void *flushWorker(void *arg);// take batches of a FlushJob until none are left
+static _Atomic int64_t *slotAt(Frame *fr, int offset);// a child slot inside the frame's page
+static void unswizzleFrame(PoolMgmt *pm, Frame *fr);// put page numbers back in the slots naming this frame and in its own
+static void moveSwizzled(PoolMgmt *pm, Frame *src, Frame *to);// a retiring frame's page moved: repoint slots and links
+static bool pinSwizzledLatchFree(PoolMgmt *pm, BM_PageHandle *parent, int offset, BM_PageHandle *child);
+static RC evictFrame(PoolMgmt *pm, Frame *fr);// write back if dirty, remember as ghost, leave the frame empty;
+                                               // RC_BM_PAGE_PINNED when a latch-free pin got there first
+static RC evictClaimed(PoolMgmt *pm, Frame *fr);// evictFrame for a frame already claimed
 static void touchForLRU(PoolMgmt *pm, Frame *fr);//update LRU timestamp 
+static void coldFrame(Frame *fr);// move to the cold end, next in line for eviction
+static void protectFrame(PoolMgmt *pm, Frame *fr);// into the protected segment, demoting its coldest member when full
+static void readAhead(PoolMgmt *pm, ReplacementStrategy strat, int fileId, PageNumber first);// load the pages after a scan miss
+static void markFrameDirty(Frame *fr, int from, int to);// add bytes [from, to) to the frame's modified range
+static char *frameSlot(FrameArena *arena, int i);// data pointer of frame i inside the arena
+static RC carveFrames(PoolMgmt *pm, int first, int count);// back frames [first, first+count) with new segments
+static void resetFrame(Frame *fr, char *data, int node);// empty frame over the given slot
+static void releaseFrames(PoolMgmt *pm);// unmap every segment
+static unsigned long long victimKey(Frame *fr, ReplacementStrategy strat);// smaller key = evicted sooner
+static RC drainRetiringFrames(PoolMgmt *pm, ReplacementStrategy strat);// move or evict unpinned frames beyond target
+static void recordGhost(PoolMgmt *pm, int fileId, PageNumber p);// remember an evicted page
+static void checkGhost(PoolMgmt *pm, int fileId, PageNumber p);// count a miss that a larger pool would have hit
+static void dropGhost(PoolMgmt *pm, int slot);// forget a live ghost
+static bool fileIsOpen(PoolMgmt *pm, int fileId);// fileId names an open file of the pool
+static RC flushFileFrames(PoolMgmt *pm, int fileId);// write back unpinned dirty frames, of one file or all when fileId < 0
+static int pickFrameForLoad(PoolMgmt *pm, ReplacementStrategy strat);// empty or victim frame, node-local first in NUMA mode
+static void latchPool(PoolMgmt *pm);// take the pool latch in concurrent mode, counting contention
+static void unlatchPool(PoolMgmt *pm);
+static int loadWarmList(PoolMgmt *pm, int maxPages);// read the sidecar, keep the hottest maxPages sorted by page
+static void *warmupMain(void *arg);// background reload of warmList into empty frames
+static RC readBatchMisses(PoolMgmt *pm, BatchPin *b, int n, int fileId);// load a batch's misses, one preadv per run of pages
+static void saveWarmList(PoolMgmt *pm, ReplacementStrategy strat);// write resident pages of file 0, hottest first
 
 static PoolMgmt *mgmt(BM_BufferPool *const bm) {
     return (PoolMgmt*)bm->mgmtData;
 }
 
-static int findFrameIndexByPage(PoolMgmt *pm, PageNumber p) {
-    // simple linear scan
-    for (int i = 0; i < pm->capacity; i++) {
-        if (pm->frames[i].pageNum == p) {
+static int findFrameIndexByPage(PoolMgmt *pm, int fileId, PageNumber p) {
+    // only latch holders remove from the table, so the caller needs no critical section
+    return ptLookup(&pm->table, fileId, p);
+}
+
+static int frameOfHandle(PoolMgmt *pm, BM_PageHandle *page, int fileId) {
+    // handles from pin name their frame; zeroed hand-built and stale ones fail the check and
+    // take the page-table lookup. Generation 0 is never live, so a zeroed handle cannot match
+    int i = page->frameIdx;
+    if (i >= 0 && i < pm->capacity) {
+        Frame *fr = &pm->frames[i];
+        if (fr->gen != 0 && fr->gen == page->frameGen && fr->pageNum == page->pageNum && fr->fileId == fileId) {
             return i;
         }
     }
-    return -1;
+    return findFrameIndexByPage(pm, fileId, page->pageNum);
 }
 
-static int findEmptyFrameIndex(PoolMgmt *pm) {
-    // first slot whose pageNum is NO_PAGE
-    for (int i = 0; i < pm->capacity; i++) {
-        if (pm->frames[i].pageNum == NO_PAGE) {
-            return i;
+static RC tagFrame(PoolMgmt *pm, Frame *fr, int fileId, PageNumber p) {
+    // a lookup that lands here before the tag is written fails the latch-free check and waits on the latch
+    RC rc = ptInsert(&pm->table, fileId, p, (int)(fr - pm->frames));
+    if (rc != RC_OK) return rc;
+    pm->nextGen += 1;
+    if (pm->nextGen == 0) pm->nextGen = 1; // 0 marks an empty frame
+    fr->gen = pm->nextGen; // before the tag, so a pin that sees the tag sees this generation
+    fr->fileId = fileId;
+    fr->pageNum = p;
+    if (p > pm->files[fileId].highPage) pm->files[fileId].highPage = p;
+    return RC_OK;
+}
+
+static bool claimFrame(Frame *fr) {
+    int expect = 0;
+    return atomic_compare_exchange_strong(&fr->fixCount, &expect, FRAME_CLAIMED);
+}
+
+static void claimFrameWait(Frame *fr) {
+    while (!claimFrame(fr)) sched_yield();
+}
+
+static void unfixFrame(Frame *fr) {
+    int c = atomic_load(&fr->fixCount);
+    while (c > 0 && !atomic_compare_exchange_weak(&fr->fixCount, &c, c - 1)) {
+    }
+}
+
+static void clearFrame(PoolMgmt *pm, Frame *fr) {
+    unswizzleFrame(pm, fr);
+    if (fr->pageNum != NO_PAGE) ptRemove(&pm->table, fr->fileId, fr->pageNum);
+    resetFrame(fr, fr->data, fr->node);
+}
+
+static void fileFramesBegin(PoolMgmt *pm, FileFrameIter *it, int fileId, PageNumber from, PageNumber to) {
+    // a range no wider than the pool is cheaper to look up page by page than to scan every frame
+    PageNumber high = pm->files[fileId].highPage;
+    it->fileId = fileId;
+    it->from = from;
+    it->to = (high < to) ? high + 1 : to;
+    it->lookup = (int64_t)it->to - from <= pm->capacity;
+    it->next = it->lookup ? from : 0;
+}
+
+static int fileFramesNext(PoolMgmt *pm, FileFrameIter *it) {
+    // under the latch; the frame returned may be cleared before the next call
+    if (it->lookup) {
+        while (it->next < it->to) {
+            int f = findFrameIndexByPage(pm, it->fileId, (PageNumber)it->next++);
+            if (f >= 0) return f;
         }
+        return -1;
+    }
+    while (it->next < pm->capacity) {
+        Frame *fr = &pm->frames[it->next++];
+        if (fr->pageNum == NO_PAGE || fr->fileId != it->fileId) continue;
+        if (fr->pageNum >= it->from && fr->pageNum < it->to) return (int)(it->next - 1);
     }
     return -1;
 }
 
-static int pickVictim(PoolMgmt *pm, ReplacementStrategy strat) {
-    int firstFree = -1;
+static bool claimFileFrames(PoolMgmt *pm, int fileId, PageNumber from, PageNumber to) {
+    FileFrameIter it;
+    int f;
+    fileFramesBegin(pm, &it, fileId, from, to);
+    while ((f = fileFramesNext(pm, &it)) >= 0) {
+        if (claimFrame(&pm->frames[f])) continue;
+        // give back the claims taken so far
+        FileFrameIter undo;
+        int g;
+        fileFramesBegin(pm, &undo, fileId, from, to);
+        while ((g = fileFramesNext(pm, &undo)) != f) pm->frames[g].fixCount = 0;
+        return FALSE;
+    }
+    return TRUE;
+}
 
-    for (int i = 0; i < pm->capacity; i++) {
-        if (pm->frames[i].fixCount == 0 && pm->frames[i].pageNum != NO_PAGE) {
-            firstFree = i;
-            break;
+static bool pauseFastPath(PoolMgmt *pm) {
+    bool wasOpen = atomic_exchange(&pm->fastGate, FALSE);
+    if (wasOpen) ptSynchronize(&pm->table);
+    return wasOpen;
+}
+
+static void resumeFastPath(PoolMgmt *pm, bool wasOpen) {
+    if (wasOpen) atomic_store(&pm->fastGate, pm->fastAllowed);
+}
+
+static void updateFastPath(PoolMgmt *pm) {
+    // latency histograms and trace rings are only safe under the latch; the MRC sampler locks for itself
+    pm->fastAllowed = pm->concurrent && !pm->numa && pm->latency == NULL && pm->trace == NULL;
+    if (pm->fastAllowed) atomic_store(&pm->fastGate, TRUE);
+    else (void)pauseFastPath(pm); // pins already past the gate finish before tracking starts
+}
+
+static int statShard(void) {
+    static _Atomic unsigned int dealt = 0;
+    static __thread int shard = -1;
+    if (shard < 0) shard = (int)(atomic_fetch_add(&dealt, 1) % STAT_SHARDS);
+    return shard;
+}
+
+static uint64_t statTotal(PoolMgmt *pm, size_t offset) {
+    uint64_t n = 0;
+    for (int s = 0; s < STAT_SHARDS; s++) n += *(const uint64_t*)((const char*)&pm->shards[s].stats + offset);
+    return n;
+}
+
+static unsigned long long fastTick(PoolMgmt *pm) {
+    // a coarse clock: hits between two advances share a stamp, and the clock's line is written
+    // once every FAST_TICK_EVERY hits of a thread rather than on each
+    static __thread unsigned int hits = 0;
+    if (++hits % FAST_TICK_EVERY == 0) return atomic_fetch_add_explicit(&pm->tick, 1, memory_order_relaxed) + 1;
+    return atomic_load_explicit(&pm->tick, memory_order_relaxed);
+}
+
+static void clearPrefetched(Frame *fr) {
+    // a plain hit ends read-ahead status, as under the latch; read first to keep the line shared
+    if (atomic_load_explicit(&fr->prefetched, memory_order_relaxed)) {
+        atomic_store_explicit(&fr->prefetched, FALSE, memory_order_relaxed);
+    }
+}
+
+static bool pinLatchFree(PoolMgmt *pm, BM_PageHandle *page, int fileId, PageNumber pageNum) {
+    if (!atomic_load_explicit(&pm->fastGate, memory_order_relaxed)) return FALSE;
+    if (!ptEnter(&pm->table)) return FALSE;
+    bool pinned = FALSE;
+    // the gate is read inside the critical section, so a pause that saw it open waits for us
+    if (atomic_load(&pm->fastGate)) {
+        int idx = ptLookup(&pm->table, fileId, pageNum);
+        Frame *fr = (idx >= 0) ? &pm->frames[idx] : NULL;
+        int c = (fr != NULL) ? atomic_load(&fr->fixCount) : FRAME_CLAIMED;
+        while (c >= 0 && !atomic_compare_exchange_weak(&fr->fixCount, &c, c + 1)) {
+        }
+        if (c >= 0) {
+            // pinned: the frame can no longer be emptied, but it may have been retagged since the lookup
+            if (fr->pageNum == pageNum && fr->fileId == fileId && !fr->loading) {
+                fr->lru = fastTick(pm);
+                clearPrefetched(fr);
+                page->pageNum = pageNum;
+                page->data = fr->data + 1;
+                page->frameIdx = idx;
+                page->frameGen = fr->gen;
+                pinned = TRUE;
+                if (pm->mrc != NULL && mrcSampled(pm->mrc, mrcHash(fileId, pageNum))) mrcAccess(pm->mrc, fileId, pageNum);
+            } else {
+                unfixFrame(fr);
+            }
         }
     }
-    if (firstFree < 0) return -1;
+    ptExit(&pm->table);
+    if (pinned) FAST_COUNT(pm, fastPins);
+    return pinned;
+}
+
+static bool unpinLatchFree(PoolMgmt *pm, BM_PageHandle *page, int fileId) {
+    if (!atomic_load_explicit(&pm->fastGate, memory_order_relaxed)) return FALSE;
+    if (!ptEnter(&pm->table)) return FALSE;
+    bool done = FALSE;
+    // retiring frames drain on their last unpin, which needs the latch
+    int i = page->frameIdx;
+    if (atomic_load(&pm->fastGate) && i >= 0 && i < pm->target) {
+        Frame *fr = &pm->frames[i];
+        if (fr->gen != 0 && fr->gen == page->frameGen && fr->pageNum == page->pageNum && fr->fileId == fileId
+            && atomic_load(&fr->fixCount) > 0) {
+            unfixFrame(fr);
+            done = TRUE;
+        }
+    }
+    ptExit(&pm->table);
+    if (done) FAST_COUNT(pm, fastUnpins);
+    return done;
+}
+
+static _Atomic int64_t *slotAt(Frame *fr, int offset) {
+    return (_Atomic int64_t*)(fr->data + 1 + offset);
+}
+
+static void unswizzleFrame(PoolMgmt *pm, Frame *fr) {
+    // the frame is claimed: no pin can reach it through a slot while the links come apart
+    int self = (int)(fr - pm->frames);
+    if (fr->swizParent >= 0) {
+        Frame *parent = &pm->frames[fr->swizParent];
+        atomic_store(slotAt(parent, fr->swizOffset), (int64_t)fr->pageNum);
+        parent->swizChildren -= 1;
+        fr->swizParent = -1;
+        STAT_ADD(pm, unswizzled, 1);
+    }
+    for (int i = 0; i < pm->capacity && fr->swizChildren > 0; i++) {
+        Frame *c = &pm->frames[i];
+        if (c->swizParent != self) continue;
+        atomic_store(slotAt(fr, c->swizOffset), (int64_t)c->pageNum);
+        c->swizParent = -1;
+        fr->swizChildren -= 1;
+        STAT_ADD(pm, unswizzled, 1);
+    }
+}
+
+static void moveSwizzled(PoolMgmt *pm, Frame *src, Frame *to) {
+    // the page data was copied with its slots; only the frame numbers in them change
+    int from = (int)(src - pm->frames), dst = (int)(to - pm->frames);
+    to->swizOffset = src->swizOffset;
+    to->swizParent = src->swizParent;
+    if (to->swizParent >= 0) atomic_store(slotAt(&pm->frames[to->swizParent], to->swizOffset), -(int64_t)dst - 1);
+    to->swizChildren = src->swizChildren;
+    for (int i = 0; i < pm->capacity && src->swizChildren > 0; i++) {
+        if (pm->frames[i].swizParent == from) pm->frames[i].swizParent = dst;
+    }
+    src->swizParent = -1;
+    src->swizChildren = 0;
+}
+
+static bool pinSwizzledLatchFree(PoolMgmt *pm, BM_PageHandle *parent, int offset, BM_PageHandle *child) {
+    if (!atomic_load_explicit(&pm->fastGate, memory_order_relaxed)) return FALSE;
+    if (!ptEnter(&pm->table)) return FALSE;
+    bool pinned = FALSE;
+    int p = parent->frameIdx;
+    if (atomic_load(&pm->fastGate) && p >= 0 && p < pm->capacity && pm->frames[p].gen == parent->frameGen) {
+        int64_t v = atomic_load(slotAt(&pm->frames[p], offset));
+        int idx = (v < 0 && v >= -(int64_t)pm->capacity) ? (int)(-v - 1) : -1; // the slot may hold any bytes
+        Frame *fr = (idx >= 0) ? &pm->frames[idx] : NULL;
+        int c = (fr != NULL) ? atomic_load(&fr->fixCount) : FRAME_CLAIMED;
+        while (c >= 0 && !atomic_compare_exchange_weak(&fr->fixCount, &c, c + 1)) {
+        }
+        if (c >= 0) {
+            // the link back to this slot proves the frame still holds the slot's child
+            if (fr->swizParent == p && fr->swizOffset == offset && !fr->loading) {
+                fr->lru = fastTick(pm);
+                clearPrefetched(fr);
+                child->pageNum = fr->pageNum;
+                child->data = fr->data + 1;
+                child->frameIdx = idx;
+                child->frameGen = fr->gen;
+                pinned = TRUE;
+                if (pm->mrc != NULL && mrcSampled(pm->mrc, mrcHash(fr->fileId, child->pageNum))) {
+                    mrcAccess(pm->mrc, fr->fileId, child->pageNum);
+                }
+            } else {
+                unfixFrame(fr);
+            }
+        }
+    }
+    ptExit(&pm->table);
+    if (pinned) {
+        FAST_COUNT(pm, fastPins);
+        FAST_COUNT(pm, swizzledPins);
+    }
+    return pinned;
+}
+
+static int findEmptyFrameIndex(PoolMgmt *pm, int node) {
+    // first slot whose pageNum is NO_PAGE; retiring frames are never handed out
+    for (int i = 0; i < pm->target; i++) {
+        if (node >= 0 && pm->frames[i].node != node) continue;
+        if (pm->frames[i].pageNum == NO_PAGE) {
+            return i;
+        }
+    }
+    return -1;
+}
 
-    int victim = firstFree;
+static int pickVictim(PoolMgmt *pm, ReplacementStrategy strat, int node) {
+    // lowest priority class first, within it the protected segment last, then the policy's key
+    int victim = -1, bestRank = INT_MAX;
     unsigned long long bestKey = ULLONG_MAX;
 
-    for (int i = 0; i < pm->capacity; i++) {
+    for (int i = 0; i < pm->target; i++) {
         Frame *fr = &pm->frames[i];
         if (fr->fixCount != 0 || fr->pageNum == NO_PAGE) continue;
+        if (node >= 0 && fr->node != node) continue;
 
-        unsigned long long key;
-        switch (strat) {
-            case RS_FIFO:
-                key = fr->seq; 
-                break;
-            case RS_LRU:
-                key = fr->lru; 
-                break;
-            default:
-             
-                key = fr->lru;
-                break;
-        }
-
-        if (key < bestKey) {
+        int rank = (int)fr->priority * 2 + (fr->hot ? 1 : 0);
+        unsigned long long key = victimKey(fr, strat);
+        if (victim < 0 || rank < bestRank || (rank == bestRank && key < bestKey)) {
+            bestRank = rank;
             bestKey = key;
             victim = i;
         }
@@ -96,266 +544,2177 @@ static int pickVictim(PoolMgmt *pm, ReplacementStrategy strat) {
     return victim;
 }
 
+static int *ghostChain(PoolMgmt *pm, int fileId, PageNumber p) {
+    return &pm->ghostHeads[mrcHash(fileId, p) & pm->ghostMask];
+}
+
+static void dropGhost(PoolMgmt *pm, int slot) {
+    // live ghosts, and only they, are on their chain
+    Ghost *g = &pm->ghosts[slot];
+    if (g->pageNum == NO_PAGE) return;
+    int *link = ghostChain(pm, g->fileId, g->pageNum);
+    while (*link != slot) link = &pm->ghosts[*link].next;
+    *link = g->next;
+    g->pageNum = NO_PAGE;
+}
+
+static void recordGhost(PoolMgmt *pm, int fileId, PageNumber p) {
+    if (pm->ghosts == NULL) return;
+    pm->evictions += 1;
+    int slot = (int)(pm->evictions % pm->ghostCap);
+    dropGhost(pm, slot); // the oldest ghost makes room
+    Ghost *g = &pm->ghosts[slot];
+    g->fileId = fileId;
+    g->pageNum = p;
+    g->evictNo = pm->evictions;
+    int *head = ghostChain(pm, fileId, p);
+    g->next = *head;
+    *head = slot;
+}
+
+static void checkGhost(PoolMgmt *pm, int fileId, PageNumber p) {
+    if (pm->ghosts == NULL) return;
+    for (int i = *ghostChain(pm, fileId, p); i >= 0; i = pm->ghosts[i].next) {
+        Ghost *g = &pm->ghosts[i];
+        if (g->pageNum != p || g->fileId != fileId) continue;
+        // d evictions happened since: d + 1 more frames would have kept the page (exact for LRU)
+        unsigned long long d = pm->evictions - g->evictNo;
+        pm->ghostHist[d * GHOST_BUCKETS / pm->ghostCap] += 1;
+        dropGhost(pm, i); // count each eviction at most once
+        return;
+    }
+}
+
+static unsigned long long victimKey(Frame *fr, ReplacementStrategy strat) {
+    switch (strat) {
+        case RS_FIFO:
+            return fr->seq;
+        case RS_LRU:
+            return fr->lru;
+        default:
+            return fr->lru;
+    }
+}
+
 static RC flushFrameIfDirty(PoolMgmt *pm, Frame *fr) {
     if (fr->pageNum == NO_PAGE) return RC_OK; 
     if (!fr->dirty) return RC_OK;
 
     // write the page back
-    RC rc = writeBlock(fr->pageNum, &pm->fh, fr->data + 1);
+    char image[PAGE_SIZE];
+    RC rc = writeBlock(fr->pageNum, &pm->files[fr->fileId].fh, diskImage(pm, fr, image));
     if (rc != RC_OK) return rc;
 
-    pm->numWriteIO += 1;
+    STAT_ADD(pm, writeIO, 1);
+    STAT_ADD(pm, bytesWritten, PAGE_SIZE);
     fr->dirty = FALSE;
     return RC_OK;
 }
 
-static RC evictIfNeededAndLoad(PoolMgmt *pm, int fidx, PageNumber pageNum) {
+static char *diskImage(PoolMgmt *pm, Frame *fr, char *scratch) {
+    // swizzled slots go to disk as the page numbers they stand for
+    if (fr->swizChildren == 0) return fr->data + 1;
+    memcpy(scratch, fr->data + 1, PAGE_SIZE);
+    int self = (int)(fr - pm->frames);
+    for (int i = 0; i < pm->capacity; i++) {
+        Frame *c = &pm->frames[i];
+        if (c->swizParent == self) memcpy(scratch + c->swizOffset, &(int64_t){ c->pageNum }, sizeof(int64_t));
+    }
+    return scratch;
+}
+
+static RC evictFrame(PoolMgmt *pm, Frame *fr) {
+    if (!claimFrame(fr)) return RC_BM_PAGE_PINNED;
+    return evictClaimed(pm, fr);
+}
+
+static RC evictClaimed(PoolMgmt *pm, Frame *fr) {
+    bool wasDirty = fr->dirty;
+    unsigned long long t0 = LAT_START(pm);
+    RC rc = flushFrameIfDirty(pm, fr);
+    if (rc != RC_OK) {
+        fr->fixCount = 0; // stays resident
+        return rc;
+    }
+    if (wasDirty) LAT_RECORD(pm, LAT_MISS_EVICT_WRITE, t0);
+    if (wasDirty) STAT_ADD(pm, evictionsDirty, 1);
+    else STAT_ADD(pm, evictionsClean, 1);
+    recordGhost(pm, fr->fileId, fr->pageNum);
+    clearFrame(pm, fr);
+    return RC_OK;
+}
+
+static RC evictIfNeededAndLoad(PoolMgmt *pm, int fidx, int fileId, PageNumber pageNum) {
     Frame *fr = &pm->frames[fidx];
     if (fr->pageNum != NO_PAGE) {
-        RC rcFlush = flushFrameIfDirty(pm, fr);
-        if (rcFlush != RC_OK) return rcFlush;
+        RC rcEvict = evictFrame(pm, fr);
+        if (rcEvict != RC_OK) return rcEvict; // RC_BM_PAGE_PINNED: the caller picks another frame
     }
-    if (pageNum >= pm->fh.totalNumPages) {
-        RC rcCap = ensureCapacity(pageNum + 1, &pm->fh);
+    SM_FileHandle *fh = &pm->files[fileId].fh;
+    if (pageNum >= fh->totalNumPages) {
+        RC rcCap = ensureCapacity(pageNum + 1, fh);
         if (rcCap != RC_OK) return rcCap;
     }
-    RC rcRead = readBlock(pageNum, &pm->fh, fr->data + 1);
+    unsigned long long t0 = LAT_START(pm);
+    RC rcRead = readBlock(pageNum, fh, fr->data + 1);
     if (rcRead != RC_OK) return rcRead;
+    LAT_RECORD(pm, LAT_MISS_READ, t0);
 
-    pm->numReadIO += 1;
+    STAT_ADD(pm, readIO, 1);
+    STAT_ADD(pm, bytesRead, PAGE_SIZE);
 
-    // reset frame metadata in a simple way
-    fr->pageNum = pageNum;
+    // reset frame metadata in a simple way; the data is in place before the page table names it
+    RC rcTag = tagFrame(pm, fr, fileId, pageNum);
+    if (rcTag != RC_OK) return rcTag;
     fr->dirty = FALSE;
-    fr->fixCount = 0;
-    pm->tick += 1;
-    fr->seq = pm->tick;   // when it was loaded
-    fr->lru = pm->tick;   // most recent "use" time
+    fr->seq = ++pm->tick;   // when it was loaded
+    fr->lru = fr->seq;      // most recent "use" time
     return RC_OK;
 }
 
 static void touchForLRU(PoolMgmt *pm, Frame *fr) {
-    pm->tick += 1;
-    fr->lru = pm->tick;
+    fr->lru = ++pm->tick;
 }
 
-// Public Buffer Pool API
-RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
-                  const int numPages, ReplacementStrategy strategy,
-                  void *stratData) {
-    (void)stratData; // not used for FIFO/LRU
-    if (bm == NULL || pageFileName == NULL || numPages <= 0) return RC_FILE_HANDLE_NOT_INIT;
-
-    PoolMgmt *pm = (PoolMgmt*)calloc(1, sizeof(PoolMgmt));
-    if (pm == NULL) return RC_FILE_HANDLE_NOT_INIT;
+static void coldFrame(Frame *fr) {
+    // key 0 sorts below every tick, for FIFO and LRU alike
+    fr->seq = 0;
+    fr->lru = 0;
+}
 
-    RC rcOpen = openPageFile((char*)pageFileName, &pm->fh);
-    if (rcOpen != RC_OK) {
-        free(pm);
-        return rcOpen;
+static void protectFrame(PoolMgmt *pm, Frame *fr) {
+    if (fr->hot) return;
+    int limit = pm->target / HOT_SEGMENT_SHARE;
+    if (limit < 1) limit = 1;
+    int held = 0;
+    Frame *coldest = NULL;
+    for (int i = 0; i < pm->capacity; i++) {
+        Frame *h = &pm->frames[i];
+        if (!h->hot) continue;
+        held++;
+        if (coldest == NULL || h->lru < coldest->lru) coldest = h;
     }
+    // a full segment demotes its least recently used page; it keeps its recency outside
+    if (held >= limit && coldest != NULL) coldest->hot = FALSE;
+    fr->hot = TRUE;
+}
 
-    pm->capacity = numPages;
-    pm->frames = (Frame*)calloc(numPages, sizeof(Frame));
-    if (pm->frames == NULL) {
-        closePageFile(&pm->fh);
-        free(pm);
-        return RC_FILE_HANDLE_NOT_INIT;
+static void readAhead(PoolMgmt *pm, ReplacementStrategy strat, int fileId, PageNumber first) {
+    SM_FileHandle *fh = &pm->files[fileId].fh;
+    int fidx[SCAN_READAHEAD];
+    SM_PageHandle bufs[SCAN_READAHEAD];
+    int n = 0;
+
+    // pages already on disk, up to the first resident one. Only empty frames and pages that
+    // scans already went through are taken, and never one that needs a write-back
+    while (n < SCAN_READAHEAD && first + n < fh->totalNumPages) {
+        if (findFrameIndexByPage(pm, fileId, first + n) >= 0) break;
+        int idx = pickFrameForLoad(pm, strat);
+        if (idx < 0) break;
+        Frame *fr = &pm->frames[idx];
+        if (fr->pageNum != NO_PAGE && (fr->dirty || victimKey(fr, strat) != 0)) break;
+        if (fr->pageNum != NO_PAGE && evictFrame(pm, fr) != RC_OK) break;
+        fr->loading = TRUE; // latch-free pins back off until the read lands
+        if (tagFrame(pm, fr, fileId, first + n) != RC_OK) {
+            fr->loading = FALSE;
+            break;
+        }
+        fr->fixCount += 1; // keeps the next pick off this frame
+        fidx[n] = idx;
+        bufs[n] = fr->data + 1;
+        n++;
     }
+    if (n == 0) return;
 
-    // allocate backing storage for each frame; use 1-based addressing to match provided printers
-    for (int i = 0; i < numPages; i++) {
-        pm->frames[i].data = (char*)malloc(PAGE_SIZE + 1);
-        if (pm->frames[i].data == NULL) {
-            for (int j = 0; j < i; j++) {
-                free(pm->frames[j].data);
-            }
-            free(pm->frames);
-            closePageFile(&pm->fh);
-            free(pm);
-            return RC_FILE_HANDLE_NOT_INIT;
+    // best effort: a failed read only empties the frames again
+    RC rc = readBlocks(first, n, fh, bufs);
+    unsigned long long now = ++pm->tick;
+    for (int i = 0; i < n; i++) {
+        Frame *fr = &pm->frames[fidx[i]];
+        unfixFrame(fr);
+        if (rc != RC_OK) {
+            claimFrameWait(fr);
+            clearFrame(pm, fr);
+            continue;
         }
-        pm->frames[i].pageNum  = NO_PAGE;
-        pm->frames[i].dirty    = FALSE;
-        pm->frames[i].fixCount = 0;
-        pm->frames[i].seq      = 0;
-        pm->frames[i].lru      = 0;
+        fr->seq = now;
+        fr->lru = now;
+        fr->prefetched = TRUE;
+        fr->loading = FALSE;
+    }
+    if (rc == RC_OK) {
+        STAT_ADD(pm, readIO, n);
+        STAT_ADD(pm, bytesRead, (uint64_t)n * PAGE_SIZE);
+        STAT_ADD(pm, readAhead, n);
     }
+}
 
-    pm->numReadIO  = 0;
-    pm->numWriteIO = 0;
-    pm->tick       = 0ULL;
+static void markFrameDirty(Frame *fr, int from, int to) {
+    // a clean frame starts a new range; the flag decides, so nothing resets the range on write-back
+    if (!fr->dirty || from < fr->dirtyFrom) fr->dirtyFrom = from;
+    if (!fr->dirty || to > fr->dirtyTo) fr->dirtyTo = to;
+    fr->dirty = TRUE;
+}
 
-    bm->pageFile = (char*)pageFileName;
-    bm->numPages = numPages;
-    bm->strategy = strategy;
-    bm->mgmtData = pm;
+// Frames sit back to back behind one guard page, so every page is page-aligned while
+// fr->data keeps the 1-based addressing the provided printers expect. A trailing guard
+// page absorbs the printers' read of data[PAGE_SIZE].
+static size_t arenaBytes(int numFrames) {
+    return (size_t)(numFrames + 2) * PAGE_SIZE;
+}
 
-    return RC_OK;
+static char *frameSlot(FrameArena *arena, int i) {
+    return arena->base + (size_t)(i + 1) * PAGE_SIZE - 1;
 }
 
-RC shutdownBufferPool(BM_BufferPool *const bm) {
-    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
-    PoolMgmt *pm = mgmt(bm);
+static void resetFrame(Frame *fr, char *data, int node) {
+    fr->data     = data;
+    fr->fileId   = 0;
+    fr->pageNum  = NO_PAGE;
+    fr->dirty    = FALSE;
+    fr->seq      = 0;
+    fr->lru      = 0;
+    fr->node     = node;
+    fr->loading  = FALSE;
+    fr->gen      = 0;
+    fr->hot      = FALSE;
+    fr->prefetched = FALSE;
+    fr->priority = PP_NORMAL;
+    fr->swizParent = -1;
+    fr->swizOffset = 0;
+    fr->swizChildren = 0;
+    fr->fixCount = 0; // last: releases a claim only once the old tag is gone
+}
 
-    // Flush only unpinned dirty frames; allow shutdown even if some pages remain pinned
-    for (int i = 0; i < pm->capacity; i++) {
-        Frame *fr = &pm->frames[i];
-        if (fr->pageNum != NO_PAGE && fr->dirty && fr->fixCount == 0) {
-            RC rc = flushFrameIfDirty(pm, fr);
-            if (rc != RC_OK) return rc;
+static RC carveFrames(PoolMgmt *pm, int first, int count) {
+    // reuse slots left over in existing segments from an earlier shrink
+    for (int sg = 0; sg < pm->numSegments && count > 0; sg++) {
+        FrameSegment *seg = &pm->segments[sg];
+        while (count > 0 && first >= seg->firstFrame && first < seg->firstFrame + seg->numSlots) {
+            resetFrame(&pm->frames[first], frameSlot(&seg->arena, first - seg->firstFrame), seg->node);
+            first += 1;
+            count -= 1;
         }
     }
+    if (count == 0) return RC_OK;
 
-    // free memory
-    for (int i = 0; i < pm->capacity; i++) {
-        if (pm->frames[i].data) {
-            free(pm->frames[i].data);
-            pm->frames[i].data = NULL;
-        }
-    }
-    free(pm->frames);
-    pm->frames = NULL;
+    // NUMA mode gives each node an equal share of the frames in its own node-local mapping
+    int parts = pm->numa ? pm->numNodes : 1;
+    if (parts > count) parts = count;
 
-    RC rcClose = closePageFile(&pm->fh);
-    free(pm);
-    bm->mgmtData = NULL;
+    FrameSegment *grown = (FrameSegment*)realloc(pm->segments, sizeof(FrameSegment) * (pm->numSegments + parts));
+    if (grown == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    pm->segments = grown;
 
-    return rcClose;
-}
+    for (int p = 0; p < parts; p++) {
+        int lo = first + (int)((long long)count * p / parts);
+        int hi = first + (int)((long long)count * (p + 1) / parts);
+        FrameSegment *seg = &pm->segments[pm->numSegments];
+        RC rc = allocFrameArena(&seg->arena, arenaBytes(hi - lo), pm->backing);
+        if (rc != RC_OK) return rc;
+        pm->numSegments += 1;
 
-RC forceFlushPool(BM_BufferPool *const bm) {
-    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
-    PoolMgmt *pm = mgmt(bm);
+        seg->firstFrame = lo;
+        seg->numSlots   = hi - lo;
+        seg->node       = pm->numa ? pm->nodes[p] : -1;
+        if (seg->node >= 0) (void)bindFrameArena(&seg->arena, seg->node); // placement is best effort
 
-    for (int i = 0; i < pm->capacity; i++) {
-        Frame *fr = &pm->frames[i];
-        if (fr->pageNum != NO_PAGE && fr->dirty && fr->fixCount == 0) {
-            RC rc = flushFrameIfDirty(pm, fr);
-            if (rc != RC_OK) return rc;
+        for (int i = lo; i < hi; i++) {
+            resetFrame(&pm->frames[i], frameSlot(&seg->arena, i - lo), seg->node);
         }
     }
     return RC_OK;
 }
 
-// Page Access API
-
-RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page) {
-    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return RC_FILE_HANDLE_NOT_INIT;
-    PoolMgmt *pm = mgmt(bm);
-    int idx = findFrameIndexByPage(pm, page->pageNum);
-    if (idx < 0) return RC_READ_NON_EXISTING_PAGE;
-    pm->frames[idx].dirty = TRUE;
-    return RC_OK;
+static void releaseFrames(PoolMgmt *pm) {
+    for (int sg = 0; sg < pm->numSegments; sg++) {
+        freeFrameArena(&pm->segments[sg].arena);
+    }
+    free(pm->segments);
+    pm->segments = NULL;
+    pm->numSegments = 0;
 }
 
-RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page) {
-    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return RC_FILE_HANDLE_NOT_INIT;
-    PoolMgmt *pm = mgmt(bm);
-    int idx = findFrameIndexByPage(pm, page->pageNum);
-    if (idx < 0) return RC_READ_NON_EXISTING_PAGE;
+static RC moveRetiringFrames(PoolMgmt *pm, ReplacementStrategy strat) {
+    for (int i = pm->capacity - 1; i >= pm->target; i--) {
+        Frame *src = &pm->frames[i];
+        if (src->pageNum == NO_PAGE || !claimFrame(src)) continue; // pinned frames drain on unpin
 
-    // student: just decrement if positive
-    if (pm->frames[idx].fixCount > 0) {
-        pm->frames[idx].fixCount -= 1;
+        // keep the page if an empty frame is left, or if it is hotter than the coldest resident page
+        int dst = findEmptyFrameIndex(pm, -1);
+        if (dst < 0) {
+            int victim = pickVictim(pm, strat, -1);
+            if (victim >= 0 && victimKey(&pm->frames[victim], strat) < victimKey(src, strat)) {
+                RC rc = evictFrame(pm, &pm->frames[victim]);
+                if (rc == RC_OK) dst = victim;
+                else if (rc != RC_BM_PAGE_PINNED) {
+                    src->fixCount = 0;
+                    return rc;
+                }
+            }
+        }
+        if (dst >= 0) {
+            // the page leaves the table under src before it goes back in under dst
+            Frame *to = &pm->frames[dst];
+            int fileId = src->fileId;
+            PageNumber p = src->pageNum;
+            memcpy(to->data + 1, src->data + 1, PAGE_SIZE);
+            ptRemove(&pm->table, fileId, p);
+            if (tagFrame(pm, to, fileId, p) != RC_OK) {
+                RC rc = evictClaimed(pm, src); // no memory to move it: write it back instead
+                if (rc != RC_OK) return rc;
+                continue;
+            }
+            to->dirty    = src->dirty;
+            to->dirtyFrom = src->dirtyFrom;
+            to->dirtyTo  = src->dirtyTo;
+            to->seq      = src->seq;
+            to->lru      = src->lru;
+            to->hot      = src->hot;
+            to->prefetched = src->prefetched;
+            to->priority = src->priority;
+            moveSwizzled(pm, src, to);
+            resetFrame(src, src->data, src->node);
+        } else {
+            RC rc = evictClaimed(pm, src);
+            if (rc != RC_OK) return rc;
+        }
     }
-    // touching LRU on unpin is optional; keep it simple and don't bump here
     return RC_OK;
 }
 
-RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page) {
-    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return RC_FILE_HANDLE_NOT_INIT;
-    PoolMgmt *pm = mgmt(bm);
-    int idx = findFrameIndexByPage(pm, page->pageNum);
-    if (idx < 0) return RC_READ_NON_EXISTING_PAGE;
-    return flushFrameIfDirty(pm, &pm->frames[idx]);
+static void trimRetiredFrames(PoolMgmt *pm) {
+    // trim the empty tail; a frame still pinned keeps everything below it allocated
+    int newCap = pm->capacity;
+    while (newCap > pm->target && pm->frames[newCap - 1].pageNum == NO_PAGE) newCap--;
+    if (newCap == pm->capacity) return;
+    pm->capacity = newCap;
+
+    // unmap segments that now lie wholly beyond the pool, give back the unused tail of the last one
+    int kept = 0;
+    for (int sg = 0; sg < pm->numSegments; sg++) {
+        FrameSegment *seg = &pm->segments[sg];
+        if (seg->firstFrame >= newCap) {
+            freeFrameArena(&seg->arena);
+            continue;
+        }
+        if (seg->firstFrame + seg->numSlots > newCap) {
+            trimFrameArena(&seg->arena, arenaBytes(newCap - seg->firstFrame));
+        }
+        pm->segments[kept++] = *seg;
+    }
+    pm->numSegments = kept;
+
+    Frame *shrunk = (Frame*)realloc(pm->frames, sizeof(Frame) * newCap);
+    if (shrunk != NULL) pm->frames = shrunk;
 }
 
-RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
-           const PageNumber pageNum) {
-    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return RC_FILE_HANDLE_NOT_INIT;
-    PoolMgmt *pm = mgmt(bm);
+static RC drainRetiringFrames(PoolMgmt *pm, ReplacementStrategy strat) {
+    if (pm->capacity <= pm->target) return RC_OK;
+    // moves retag frames and the trim reallocates pm->frames; latch-free callers take the latch meanwhile
+    bool fast = pauseFastPath(pm);
+    RC rc = moveRetiringFrames(pm, strat);
+    if (rc == RC_OK) trimRetiredFrames(pm);
+    resumeFastPath(pm, fast);
+    return rc;
+}
 
-    if (pageNum < 0) return RC_READ_NON_EXISTING_PAGE;
+static int pickFrameForLoad(PoolMgmt *pm, ReplacementStrategy strat) {
+    int node = -1;
+    if (pm->numa) {
+        // only prefer the caller's node when this pool has a partition on it
+        int cur = currentNumaNode();
+        for (int n = 0; n < pm->numNodes; n++) {
+            if (pm->nodes[n] == cur) node = cur;
+        }
+    }
+    if (node >= 0) {
+        int idx = findEmptyFrameIndex(pm, node);
+        if (idx >= 0) return idx;
+    }
+    // never evict while an empty frame exists anywhere
+    int idx = findEmptyFrameIndex(pm, -1);
+    if (idx >= 0) return idx;
+    if (node >= 0) {
+        idx = pickVictim(pm, strat, node);
+        if (idx >= 0) return idx;
+    }
+    return pickVictim(pm, strat, -1);
+}
 
-    // If already cached, bump fixCount and return
-    int idx = findFrameIndexByPage(pm, pageNum);
-    if (idx >= 0) {
-        Frame *fr = &pm->frames[idx];
-        fr->fixCount += 1;
-        touchForLRU(pm, fr);
-        page->pageNum = pageNum;
-        page->data = fr->data + 1;
-        return RC_OK;
+static void latchPool(PoolMgmt *pm) {
+    if (!pm->concurrent) return;
+    if (pthread_mutex_trylock(&pm->latch) != 0) {
+        uint64_t t0 = lhNowNs();
+        pthread_mutex_lock(&pm->latch);
+        // counted once we hold the latch, like every other stat
+        STAT_ADD(pm, latchContended, 1);
+        STAT_ADD(pm, latchWaitNs, lhNowNs() - t0);
     }
+    STAT_ADD(pm, latchAcquires, 1);
+}
 
-    // Not cached: try to find an empty frame first
-    idx = findEmptyFrameIndex(pm);
+static void unlatchPool(PoolMgmt *pm) {
+    if (pm->concurrent) pthread_mutex_unlock(&pm->latch);
+}
 
-    // If no empty frame, select a victim according to strategy
-    if (idx < 0) {
-        idx = pickVictim(pm, bm->strategy);
-        if (idx < 0) {
-            // No evictable frame (all pinned)
-            return RC_WRITE_FAILED; // reuse error code to signal inability to pin
+static bool fileIsOpen(PoolMgmt *pm, int fileId) {
+    return fileId >= 0 && fileId < pm->numFiles && pm->files[fileId].open;
+}
+
+static RC flushFileFrames(PoolMgmt *pm, int fileId) {
+    FileFrameIter it;
+    if (fileId >= 0) fileFramesBegin(pm, &it, fileId, 0, INT_MAX);
+    for (int i = 0;; i++) {
+        int f = (fileId >= 0) ? fileFramesNext(pm, &it) : (i < pm->capacity ? i : -1);
+        if (f < 0) return RC_OK;
+        Frame *fr = &pm->frames[f];
+        if (fr->pageNum != NO_PAGE && fr->dirty && fr->fixCount == 0) {
+            RC rc = flushFrameIfDirty(pm, fr);
+            if (rc != RC_OK) return rc;
+            STAT_ADD(pm, flushes, 1);
         }
     }
+}
 
-    // Evict if needed and load requested page
-    RC rcLoad = evictIfNeededAndLoad(pm, idx, pageNum);
-    if (rcLoad != RC_OK) return rcLoad;
+// Warm-up sidecar: WARMUP_MAGIC, an int count, then count page numbers of file 0, hottest first
 
-    // Pin and return handle
-    Frame *fr = &pm->frames[idx];
-    fr->fixCount = 1;
-    touchForLRU(pm, fr);
+static int byWarmPage(const void *a, const void *b) {
+    const WarmEntry *x = (const WarmEntry*)a, *y = (const WarmEntry*)b;
+    return (x->pageNum > y->pageNum) - (x->pageNum < y->pageNum);
+}
 
-    page->pageNum = pageNum;
-    page->data = fr->data + 1;
-    return RC_OK;
+static int loadWarmList(PoolMgmt *pm, int maxPages) {
+    FILE *f = fopen(pm->warmName, "rb");
+    if (f == NULL) return 0;
+    char magic[8];
+    int count = 0;
+    if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, WARMUP_MAGIC, sizeof(magic)) != 0 ||
+        fread(&count, sizeof(int), 1, f) != 1 || count <= 0) {
+        fclose(f);
+        return 0;
+    }
+    // a smaller pool keeps only the hottest pages
+    if (count > maxPages) count = maxPages;
+    pm->warmList = (WarmEntry*)malloc(sizeof(WarmEntry) * count);
+    int n = 0;
+    while (pm->warmList != NULL && n < count && fread(&pm->warmList[n].pageNum, sizeof(PageNumber), 1, f) == 1) {
+        pm->warmList[n].rank = n;
+        n++;
+    }
+    fclose(f);
+
+    // page order turns the reload into a few sequential runs; duplicates only in a corrupt file
+    qsort(pm->warmList, n, sizeof(WarmEntry), byWarmPage);
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        if (pm->warmList[i].pageNum < 0) continue;
+        if (kept > 0 && pm->warmList[kept - 1].pageNum == pm->warmList[i].pageNum) continue;
+        pm->warmList[kept++] = pm->warmList[i];
+    }
+    pm->warmCount = kept;
+    return kept;
 }
 
-// Statistics API
+static void *warmupMain(void *arg) {
+    PoolMgmt *pm = (PoolMgmt*)arg;
+    int next = 0;
+    bool full = FALSE;
 
-PageNumber *getFrameContents(BM_BufferPool *const bm) {
-    if (bm == NULL || bm->mgmtData == NULL) return NULL;
+    while (next < pm->warmCount && !full) {
+        int fidx[WARMUP_BATCH];
+        SM_PageHandle bufs[WARMUP_BATCH];
+        int n = 0;
+
+        // reserve empty frames for a run of consecutive pages; warm-up never evicts
+        latchPool(pm);
+        if (pm->warmStop) {
+            unlatchPool(pm);
+            break;
+        }
+        SM_FileHandle *fh = &pm->files[0].fh; // openPoolFile may move the table
+        PageNumber first = pm->warmList[next].pageNum;
+        while (next < pm->warmCount && n < WARMUP_BATCH && pm->warmList[next].pageNum == first + n) {
+            PageNumber p = first + n;
+            if (p >= fh->totalNumPages || findFrameIndexByPage(pm, 0, p) >= 0) break;
+            int idx = findEmptyFrameIndex(pm, -1);
+            if (idx < 0) {
+                full = TRUE;
+                break;
+            }
+            Frame *fr = &pm->frames[idx];
+            fr->loading = TRUE;
+            if (tagFrame(pm, fr, 0, p) != RC_OK) {
+                fr->loading = FALSE;
+                full = TRUE;
+                break;
+            }
+            fr->fixCount += 1; // keeps the frame out of victim selection and flushes
+            fidx[n] = idx;
+            bufs[n] = fr->data + 1;
+            n++;
+            next++;
+        }
+        if (n == 0) {
+            if (!full) next++; // already resident or past the end of file
+            unlatchPool(pm);
+            continue;
+        }
+        SM_FileHandle view = *fh;
+        unlatchPool(pm);
+
+        // frames stay at their index while pinned, and their memory never moves
+        RC rc = readBlocks(first, n, &view, bufs);
+
+        latchPool(pm);
+        for (int i = 0; i < n; i++) {
+            Frame *fr = &pm->frames[fidx[i]];
+            int rank = pm->warmList[next - n + i].rank;
+            if (rc != RC_OK) {
+                unfixFrame(fr);
+                claimFrameWait(fr);
+                clearFrame(pm, fr);
+                continue;
+            }
+            // ranks sit below every tick the application uses, hottest highest
+            fr->seq = (unsigned long long)(pm->warmCount - rank);
+            fr->lru = fr->seq;
+            fr->loading = FALSE;
+            unfixFrame(fr);
+        }
+        if (rc == RC_OK) {
+            STAT_ADD(pm, readIO, n);
+            STAT_ADD(pm, bytesRead, (uint64_t)n * PAGE_SIZE);
+            STAT_ADD(pm, warmupLoaded, n);
+        }
+        pthread_cond_broadcast(&pm->loaded);
+        unlatchPool(pm);
+    }
+
+    latchPool(pm);
+    pm->warmRunning = FALSE;
+    pthread_cond_broadcast(&pm->loaded);
+    unlatchPool(pm);
+    return NULL;
+}
+
+typedef struct WarmRank { // a resident page and its hotness at shutdown
+    unsigned long long key;
+    PageNumber pageNum;
+} WarmRank;
+
+static int byHotness(const void *a, const void *b) {
+    const WarmRank *x = (const WarmRank*)a, *y = (const WarmRank*)b;
+    return (x->key < y->key) - (x->key > y->key);
+}
+
+static void saveWarmList(PoolMgmt *pm, ReplacementStrategy strat) {
+    WarmRank *ranks = (WarmRank*)malloc(sizeof(WarmRank) * (pm->capacity > 0 ? pm->capacity : 1));
+    if (ranks == NULL) return;
+    int n = 0;
+    for (int i = 0; i < pm->capacity; i++) {
+        Frame *fr = &pm->frames[i];
+        if (fr->pageNum == NO_PAGE || fr->fileId != 0 || fr->loading) continue;
+        ranks[n].key = victimKey(fr, strat);
+        ranks[n].pageNum = fr->pageNum;
+        n++;
+    }
+    // the last victim the policy would pick comes first
+    qsort(ranks, n, sizeof(WarmRank), byHotness);
+
+    // best effort: a missing sidecar only means a cold start
+    FILE *f = fopen(pm->warmName, "wb");
+    if (f != NULL) {
+        fwrite(WARMUP_MAGIC, 1, 8, f);
+        fwrite(&n, sizeof(int), 1, f);
+        for (int i = 0; i < n; i++) fwrite(&ranks[i].pageNum, sizeof(PageNumber), 1, f);
+        fclose(f);
+    }
+    free(ranks);
+}
+
+// Public Buffer Pool API
+RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
+                  const int numPages, ReplacementStrategy strategy,
+                  void *stratData) {
+    return initBufferPoolWithOptions(bm, pageFileName, numPages, strategy, stratData, NULL);
+}
+
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+                             const int numPages, ReplacementStrategy strategy,
+                             void *stratData, const BM_PoolOptions *const opts) {
+    (void)stratData; // not used for FIFO/LRU
+    if (bm == NULL || pageFileName == NULL || numPages <= 0) return RC_FILE_HANDLE_NOT_INIT;
+    bool numa = (opts != NULL) ? opts->numaAware : FALSE;
+
+    // the counter shards are cache-line aligned, which calloc does not promise
+    PoolMgmt *pm = (PoolMgmt*)aligned_alloc(_Alignof(PoolMgmt), sizeof(PoolMgmt));
+    if (pm == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    memset(pm, 0, sizeof(PoolMgmt));
+
+    // the pool's own page file is fileId 0; more can be attached with openPoolFile
+    pm->files = (PoolFile*)calloc(1, sizeof(PoolFile));
+    if (pm->files == NULL) {
+        free(pm);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    RC rcOpen = openPageFile((char*)pageFileName, &pm->files[0].fh);
+    if (rcOpen != RC_OK) {
+        free(pm->files);
+        free(pm);
+        return rcOpen;
+    }
+    pm->files[0].name = (char*)pageFileName;
+    pm->files[0].open = TRUE;
+    pm->files[0].nextPage = pm->files[0].fh.totalNumPages;
+    pm->files[0].highPage = -1;
+    pm->numFiles = 1;
+
+    pm->capacity = numPages;
+    pm->target = numPages;
+    pm->backing = (opts != NULL) ? opts->backing : FB_DEFAULT;
+    pm->numa = numa;
+    pm->highShare = (opts != NULL && opts->highPriorityShare > 0.0) ? opts->highPriorityShare : HIGH_PRIORITY_SHARE;
+    if (pm->highShare > 1.0) pm->highShare = 1.0;
+    pm->numNodes = numa ? onlineNumaNodes(pm->nodes, MAX_NUMA_NODES) : 1;
+    pm->frames = (Frame*)calloc(numPages, sizeof(Frame));
+    if (pm->frames == NULL) {
+        closePageFile(&pm->files[0].fh);
+        free(pm->files);
+        free(pm);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    // a few large mappings instead of a malloc per frame; huge pages cut TLB misses
+    RC rcArena = carveFrames(pm, 0, numPages);
+    if (rcArena != RC_OK) {
+        releaseFrames(pm);
+        free(pm->frames);
+        closePageFile(&pm->files[0].fh);
+        free(pm->files);
+        free(pm);
+        return rcArena;
+    }
+    // room for growth up front; a pool grown past it rebuckets the table in resizeBufferPool
+    RC rcTable = initPageTable(&pm->table, 2 * numPages);
+    if (rcTable != RC_OK) {
+        releaseFrames(pm);
+        free(pm->frames);
+        closePageFile(&pm->files[0].fh);
+        free(pm->files);
+        free(pm);
+        return rcTable;
+    }
+
+    pm->tick       = 0ULL;
+    pm->warmup     = (opts != NULL) ? opts->warmup : FALSE;
+    pm->concurrent = (opts != NULL) ? (opts->concurrent || pm->warmup) : FALSE; // the reload runs beside the caller
+    if (pm->concurrent) {
+        pthread_mutex_init(&pm->latch, NULL);
+        pthread_cond_init(&pm->loaded, NULL);
+    }
+    updateFastPath(pm);
+
+    bm->pageFile = (char*)pageFileName;
+    bm->numPages = numPages;
+    bm->strategy = strategy;
+    bm->mgmtData = pm;
+
+    if (pm->warmup) {
+        pm->warmName = (char*)malloc(strlen(pageFileName) + sizeof(WARMUP_SUFFIX));
+        if (pm->warmName != NULL) {
+            strcpy(pm->warmName, pageFileName);
+            strcat(pm->warmName, WARMUP_SUFFIX);
+        }
+        // a missing or unreadable sidecar is a cold start, not an error
+        if (pm->warmName != NULL && loadWarmList(pm, numPages) > 0) {
+            pm->tick = (unsigned long long)pm->warmCount;
+            pm->warmRunning = TRUE;
+            pm->warmStarted = (pthread_create(&pm->warmThread, NULL, warmupMain, pm) == 0);
+            if (!pm->warmStarted) pm->warmRunning = FALSE;
+        }
+    }
+    return RC_OK;
+}
+
+RC shutdownBufferPool(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+
+    if (pm->warmStarted) {
+        latchPool(pm);
+        pm->warmStop = TRUE;
+        unlatchPool(pm);
+        pthread_join(pm->warmThread, NULL);
+        pm->warmStarted = FALSE;
+    }
+
+    // Flush only unpinned dirty frames; allow shutdown even if some pages remain pinned
+    RC rcFlush = flushFileFrames(pm, -1);
+    if (rcFlush != RC_OK) return rcFlush;
+    if (pm->warmup && pm->warmName != NULL) saveWarmList(pm, bm->strategy);
+
+    // free memory
+    releaseFrames(pm);
+    free(pm->frames);
+    pm->frames = NULL;
+    freePageTable(&pm->table);
+
+    RC rcClose = closePageFile(&pm->files[0].fh);
+    for (int f = 1; f < pm->numFiles; f++) {
+        if (!pm->files[f].open) continue;
+        closePageFile(&pm->files[f].fh);
+        free(pm->files[f].name);
+    }
+    free(pm->files);
+    free(pm->ghosts);
+    free(pm->ghostHeads);
+    free(pm->latency);
+    if (pm->trace != NULL) (void)closeAccessTrace(pm->trace);
+    freeMrcSampler(pm->mrc);
+    free(pm->mrc);
+    free(pm->warmName);
+    free(pm->warmList);
+    if (pm->concurrent) {
+        pthread_cond_destroy(&pm->loaded);
+        pthread_mutex_destroy(&pm->latch);
+    }
+    free(pm);
+    bm->mgmtData = NULL;
+
+    return rcClose;
+}
+
+RC waitForWarmup(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    latchPool(pm);
+    while (pm->warmRunning) pthread_cond_wait(&pm->loaded, &pm->latch);
+    unlatchPool(pm);
+    return RC_OK;
+}
+
+static RC resizeBufferPoolLocked(BM_BufferPool *const bm, const int newNumPages) {
+    if (bm == NULL || bm->mgmtData == NULL || newNumPages <= 0) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+
+    bool fast = pauseFastPath(pm); // latch-free callers index pm->frames and read target
+    if (newNumPages > pm->capacity) {
+        // grow: existing frames keep their memory, only the metadata array moves
+        Frame *grown = (Frame*)realloc(pm->frames, sizeof(Frame) * newNumPages);
+        RC rc = (grown != NULL) ? RC_OK : RC_FILE_HANDLE_NOT_INIT;
+        if (grown != NULL) pm->frames = grown;
+        if (rc == RC_OK) rc = carveFrames(pm, pm->capacity, newNumPages - pm->capacity);
+        if (rc != RC_OK) {
+            resumeFastPath(pm, fast);
+            return rc;
+        }
+        pm->capacity = newNumPages;
+        // with the latch-free path drained nobody is in the table; on failure chains only get longer
+        (void)ptRehash(&pm->table, 2 * newNumPages);
+    }
+    pm->target = newNumPages;
+
+    // shrink: whatever is unpinned moves down or leaves now, pinned frames follow on unpin
+    RC rc = drainRetiringFrames(pm, bm->strategy);
+    bm->numPages = pm->capacity;
+    resumeFastPath(pm, fast);
+    return rc;
+}
+
+RC resizeBufferPool(BM_BufferPool *const bm, const int newNumPages) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = resizeBufferPoolLocked(bm, newNumPages);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+// Pool flush: the dirty unpinned frames are pinned and sorted under the latch, then written in
+// batches by a few threads that take the latch only to clear and restore dirty flags
+
+static int byFlushPage(const void *a, const void *b) {
+    const FlushPage *x = (const FlushPage*)a, *y = (const FlushPage*)b;
+    if (x->fileId != y->fileId) return (x->fileId > y->fileId) - (x->fileId < y->fileId);
+    return (x->pageNum > y->pageNum) - (x->pageNum < y->pageNum);
+}
+
+static void lockFlush(FlushJob *job) {
+    if (job->pm->concurrent) latchPool(job->pm);
+    else pthread_mutex_lock(&job->lock); // nothing but the writers runs beside an unlatched pool's flush
+}
+
+static void unlockFlush(FlushJob *job) {
+    if (job->pm->concurrent) unlatchPool(job->pm);
+    else pthread_mutex_unlock(&job->lock);
+}
+
+static RC flushBatch(FlushJob *job, int lo, int hi, SM_PageHandle *bufs, SM_FileHandle *views, char *scratch) {
+    PoolMgmt *pm = job->pm;
+    RC rc = RC_OK;
+
+    // dirty flags are cleared before the write: a change made while it runs dirties the frame again
+    lockFlush(job);
+    for (int k = lo; k < hi; k++) {
+        FlushPage *fp = &job->pages[k];
+        Frame *fr = &pm->frames[fp->frame];
+        fp->write = FALSE;
+        fp->ok = FALSE;
+        if (!fr->dirty) continue; // written by forcePage meanwhile
+        SM_FileHandle *fh = &pm->files[fp->fileId].fh;
+        if (fp->pageNum >= fh->totalNumPages) {
+            // past the end of the file: growing it is left to latch holders, one write at a time
+            RC rcOne = flushFrameIfDirty(pm, fr);
+            if (rcOne == RC_OK) STAT_ADD(pm, flushes, 1);
+            else if (rc == RC_OK) rc = rcOne;
+            continue;
+        }
+        fp->dirtyFrom = fr->dirtyFrom;
+        fp->dirtyTo = fr->dirtyTo;
+        fr->dirty = FALSE;
+        fp->write = TRUE;
+        bufs[k - lo] = diskImage(pm, fr, scratch + (size_t)(k - lo) * PAGE_SIZE);
+        views[k - lo] = *fh; // openPoolFile may move the file table
+    }
+    unlockFlush(job);
+
+    // one vectored write per run of consecutive pages of one file
+    for (int k = lo; k < hi;) {
+        FlushPage *fp = &job->pages[k];
+        if (!fp->write) {
+            k++;
+            continue;
+        }
+        int n = 1;
+        while (k + n < hi && fp[n].write && fp[n].fileId == fp->fileId && fp[n].pageNum == fp->pageNum + n) n++;
+        RC rcRun = writeBlocks(fp->pageNum, n, &views[k - lo], &bufs[k - lo]);
+        for (int m = 0; m < n; m++) fp[m].ok = (rcRun == RC_OK);
+        if (rcRun != RC_OK && rc == RC_OK) rc = rcRun;
+        k += n;
+    }
+
+    lockFlush(job);
+    for (int k = lo; k < hi; k++) {
+        FlushPage *fp = &job->pages[k];
+        if (!fp->write) continue;
+        Frame *fr = &pm->frames[fp->frame];
+        if (!fp->ok) {
+            markFrameDirty(fr, fp->dirtyFrom, fp->dirtyTo);
+            continue;
+        }
+        STAT_ADD(pm, writeIO, 1);
+        STAT_ADD(pm, bytesWritten, PAGE_SIZE);
+        STAT_ADD(pm, flushes, 1);
+    }
+    unlockFlush(job);
+    return rc;
+}
+
+static void *flushWorker(void *arg) {
+    FlushJob *job = (FlushJob*)arg;
+    SM_PageHandle *bufs = (SM_PageHandle*)malloc(sizeof(SM_PageHandle) * job->depth);
+    SM_FileHandle *views = (SM_FileHandle*)malloc(sizeof(SM_FileHandle) * job->depth);
+    char *scratch = (char*)malloc((size_t)job->depth * PAGE_SIZE); // copies of pages with swizzled slots
+    RC rc = (bufs != NULL && views != NULL && scratch != NULL) ? RC_OK : RC_FILE_HANDLE_NOT_INIT;
+
+    while (rc == RC_OK && !atomic_load(&job->failed)) {
+        int lo = atomic_fetch_add(&job->next, job->depth);
+        if (lo >= job->count) break;
+        int hi = (lo + job->depth < job->count) ? lo + job->depth : job->count;
+        rc = flushBatch(job, lo, hi, bufs, views, scratch);
+
+        // progress after every batch, one call at a time; the latch is free, so the callback may use the pool
+        pthread_mutex_lock(&job->progressLock);
+        job->done += (uint64_t)(hi - lo);
+        if (job->progress != NULL) job->progress(job->done, (uint64_t)job->count, job->progressArg);
+        pthread_mutex_unlock(&job->progressLock);
+    }
+    if (rc != RC_OK) {
+        pthread_mutex_lock(&job->progressLock);
+        if (job->rc == RC_OK) job->rc = rc;
+        pthread_mutex_unlock(&job->progressLock);
+        atomic_store(&job->failed, TRUE);
+    }
+    free(bufs);
+    free(views);
+    free(scratch);
+    return NULL;
+}
+
+static RC collectFlushLocked(PoolMgmt *pm, FlushJob *job) {
+    int n = 0;
+    for (int i = 0; i < pm->capacity; i++) {
+        Frame *fr = &pm->frames[i];
+        if (fr->pageNum != NO_PAGE && fr->dirty && fr->fixCount == 0) n++;
+    }
+    if (n == 0) return RC_OK;
+    job->pages = (FlushPage*)malloc(sizeof(FlushPage) * n);
+    if (job->pages == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    for (int i = 0; i < pm->capacity; i++) {
+        Frame *fr = &pm->frames[i];
+        if (fr->pageNum == NO_PAGE || !fr->dirty || fr->fixCount != 0) continue;
+        fr->fixCount += 1; // stays resident, and in place, while the latch is dropped
+        FlushPage *fp = &job->pages[job->count++];
+        fp->fileId = fr->fileId;
+        fp->pageNum = fr->pageNum;
+        fp->frame = i;
+    }
+    qsort(job->pages, job->count, sizeof(FlushPage), byFlushPage);
+    return RC_OK;
+}
+
+RC forceFlushPoolWithOptions(BM_BufferPool *const bm, const BM_FlushOptions *const opts) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (opts != NULL && (opts->numThreads < 0 || opts->ioDepth < 0)) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+
+    FlushJob job;
+    memset(&job, 0, sizeof(job));
+    job.pm = pm;
+    job.depth = (opts != NULL && opts->ioDepth > 0) ? opts->ioDepth : FLUSH_DEPTH;
+    job.progress = (opts != NULL) ? opts->progress : NULL;
+    job.progressArg = (opts != NULL) ? opts->progressArg : NULL;
+    atomic_init(&job.next, 0);
+    atomic_init(&job.failed, FALSE);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_mutex_init(&job.progressLock, NULL);
+
+    latchPool(pm);
+    unsigned long long t0 = LAT_START(pm);
+    RC rc = collectFlushLocked(pm, &job);
+    unlatchPool(pm);
+
+    if (rc == RC_OK && job.count > 0) {
+        // the caller is one of the writers; no more threads than batches
+        int batches = (job.count + job.depth - 1) / job.depth;
+        int threads = (opts != NULL && opts->numThreads > 1) ? opts->numThreads : 1;
+        if (threads > FLUSH_MAX_THREADS) threads = FLUSH_MAX_THREADS;
+        if (threads > batches) threads = batches;
+        pthread_t workers[FLUSH_MAX_THREADS];
+        int started = 0;
+        while (started < threads - 1 && pthread_create(&workers[started], NULL, flushWorker, &job) == 0) started++;
+        flushWorker(&job);
+        for (int t = 0; t < started; t++) pthread_join(workers[t], NULL);
+        rc = job.rc;
+    }
+
+    latchPool(pm);
+    bool drain = FALSE;
+    for (int k = 0; k < job.count; k++) {
+        unfixFrame(&pm->frames[job.pages[k].frame]);
+        if (job.pages[k].frame >= pm->target) drain = TRUE;
+    }
+    if (drain) {
+        // a shrink that waited on these frames finishes now
+        RC rcDrain = drainRetiringFrames(pm, bm->strategy);
+        bm->numPages = pm->capacity;
+        if (rc == RC_OK) rc = rcDrain;
+    }
+    if (rc == RC_OK) LAT_RECORD(pm, LAT_FORCE_FLUSH_POOL, t0);
+    unlatchPool(pm);
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_mutex_destroy(&job.progressLock);
+    free(job.pages);
+    return rc;
+}
+
+RC forceFlushPool(BM_BufferPool *const bm) {
+    return forceFlushPoolWithOptions(bm, NULL);
+}
+
+// Multi-file API
+
+static RC openPoolFileLocked(BM_BufferPool *const bm, const char *const fileName, int *fileId) {
+    if (bm == NULL || bm->mgmtData == NULL || fileName == NULL || fileId == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+
+    // reuse a closed slot before growing the table
+    int f = 1;
+    while (f < pm->numFiles && pm->files[f].open) f++;
+    if (f == pm->numFiles) {
+        PoolFile *grown = (PoolFile*)realloc(pm->files, sizeof(PoolFile) * (pm->numFiles + 1));
+        if (grown == NULL) return RC_FILE_HANDLE_NOT_INIT;
+        pm->files = grown;
+        memset(&pm->files[f], 0, sizeof(PoolFile));
+    }
+
+    PoolFile *pf = &pm->files[f];
+    pf->name = (char*)malloc(strlen(fileName) + 1);
+    if (pf->name == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    strcpy(pf->name, fileName);
+    RC rc = openPageFile(pf->name, &pf->fh);
+    if (rc != RC_OK) {
+        free(pf->name);
+        pf->name = NULL;
+        return rc;
+    }
+    pf->open = TRUE;
+    pf->nextPage = pf->fh.totalNumPages;
+    pf->highPage = -1;
+    if (f == pm->numFiles) pm->numFiles += 1;
+    *fileId = f;
+    return RC_OK;
+}
+
+RC openPoolFile(BM_BufferPool *const bm, const char *const fileName, int *fileId) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = openPoolFileLocked(bm, fileName, fileId);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC closePoolFileLocked(BM_BufferPool *const bm, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    if (fileId == 0 || !fileIsOpen(pm, fileId)) return RC_BM_INVALID_FILE; // file 0 lives as long as the pool
+
+    FileFrameIter it;
+    int f;
+    fileFramesBegin(pm, &it, fileId, 0, INT_MAX);
+    while ((f = fileFramesNext(pm, &it)) >= 0) {
+        if (pm->frames[f].fixCount > 0) return RC_BM_PAGE_PINNED;
+    }
+    RC rc = flushFileFrames(pm, fileId);
+    if (rc != RC_OK) return rc;
+    if (!claimFileFrames(pm, fileId, 0, INT_MAX)) return RC_BM_PAGE_PINNED; // pinned latch-free meanwhile
+
+    // the file's pages leave the pool; its frames become empty
+    fileFramesBegin(pm, &it, fileId, 0, INT_MAX);
+    while ((f = fileFramesNext(pm, &it)) >= 0) clearFrame(pm, &pm->frames[f]);
+    for (int g = 0; g < pm->ghostCap; g++) {
+        if (pm->ghosts[g].fileId == fileId) dropGhost(pm, g);
+    }
+
+    PoolFile *pf = &pm->files[fileId];
+    rc = closePageFile(&pf->fh);
+    free(pf->name);
+    pf->name = NULL;
+    pf->open = FALSE;
+    return rc;
+}
+
+RC closePoolFile(BM_BufferPool *const bm, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = closePoolFileLocked(bm, fileId);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC flushPoolFileLocked(BM_BufferPool *const bm, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    if (!fileIsOpen(pm, fileId)) return RC_BM_INVALID_FILE;
+    return flushFileFrames(pm, fileId);
+}
+
+RC flushPoolFile(BM_BufferPool *const bm, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = flushPoolFileLocked(bm, fileId);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+// Page Access API
+
+static RC markFileDirtyLocked(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    TRACE(pm, TRACE_MARK_DIRTY, fileId, page->pageNum);
+    int idx = frameOfHandle(pm, page, fileId);
+    if (idx < 0) return RC_READ_NON_EXISTING_PAGE;
+    markFrameDirty(&pm->frames[idx], 0, PAGE_SIZE);
+    return RC_OK;
+}
+
+RC markFileDirty(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = markFileDirtyLocked(bm, page, fileId);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC unpinFilePageLocked(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    TRACE(pm, TRACE_UNPIN, fileId, page->pageNum);
+    int idx = frameOfHandle(pm, page, fileId);
+    if (idx < 0) return RC_READ_NON_EXISTING_PAGE;
+
+    // student: just decrement if positive
+    unfixFrame(&pm->frames[idx]);
+    STAT_ADD(pm, unpins, 1);
+    // last pin on a frame left behind by a shrink: let it go now
+    if (idx >= pm->target && pm->frames[idx].fixCount == 0) {
+        RC rc = drainRetiringFrames(pm, bm->strategy);
+        bm->numPages = pm->capacity;
+        if (rc != RC_OK) return rc;
+    }
+    // touching LRU on unpin is optional; keep it simple and don't bump here
+    return RC_OK;
+}
+
+static RC unpinFilePageDirtyLocked(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+                                   const int offset, const int length) {
+    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (offset < 0 || length < 0 || offset + length > PAGE_SIZE) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    if (length > 0) {
+        TRACE(pm, TRACE_MARK_DIRTY, fileId, page->pageNum);
+        int idx = frameOfHandle(pm, page, fileId);
+        if (idx < 0) return RC_READ_NON_EXISTING_PAGE;
+        markFrameDirty(&pm->frames[idx], offset, offset + length);
+    }
+    return unpinFilePageLocked(bm, page, fileId); // the handle check is a few compares the second time
+}
+
+RC unpinFilePageDirty(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+                      const int offset, const int length) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (length == 0 && offset >= 0 && offset <= PAGE_SIZE) return unpinFilePage(bm, page, fileId);
+    latchPool(mgmt(bm));
+    RC rc = unpinFilePageDirtyLocked(bm, page, fileId, offset, length);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+RC unpinPageDirty(BM_BufferPool *const bm, BM_PageHandle *const page, const bool dirty) {
+    return unpinFilePageDirty(bm, page, 0, 0, dirty ? PAGE_SIZE : 0);
+}
+
+RC unpinPageDirtyRange(BM_BufferPool *const bm, BM_PageHandle *const page, const int offset, const int length) {
+    return unpinFilePageDirty(bm, page, 0, offset, length);
+}
+
+RC unpinFilePage(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (page != NULL && unpinLatchFree(mgmt(bm), page, fileId)) return RC_OK;
+    latchPool(mgmt(bm));
+    RC rc = unpinFilePageLocked(bm, page, fileId);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC forceFilePageLocked(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    unsigned long long t0 = LAT_START(pm);
+    int idx = frameOfHandle(pm, page, fileId);
+    if (idx < 0) return RC_READ_NON_EXISTING_PAGE;
+    if (pm->frames[idx].dirty) {
+        RC rc = flushFrameIfDirty(pm, &pm->frames[idx]);
+        if (rc != RC_OK) return rc;
+        STAT_ADD(pm, flushes, 1);
+    }
+    LAT_RECORD(pm, LAT_FORCE_PAGE, t0);
+    return RC_OK;
+}
+
+RC forceFilePage(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = forceFilePageLocked(bm, page, fileId);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC setFilePagePriorityLocked(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+                                    const BM_PagePriority priority) {
+    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (priority < PP_LOW || priority >= BM_NUM_PRIORITIES) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    int idx = frameOfHandle(pm, page, fileId);
+    if (idx < 0) return RC_READ_NON_EXISTING_PAGE;
+    Frame *fr = &pm->frames[idx];
+    if (priority == PP_HIGH && fr->priority != PP_HIGH) {
+        // the reserved region is a hard cap, so high pages can never crowd out the rest
+        int limit = (int)(pm->highShare * pm->target);
+        if (limit < 1) limit = 1;
+        int held = 0;
+        for (int i = 0; i < pm->capacity; i++) {
+            if (pm->frames[i].pageNum != NO_PAGE && pm->frames[i].priority == PP_HIGH) held++;
+        }
+        if (held >= limit) return RC_BM_BUDGET_EXCEEDED;
+    }
+    fr->priority = priority;
+    return RC_OK;
+}
+
+RC setFilePagePriority(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+                       const BM_PagePriority priority) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = setFilePagePriorityLocked(bm, page, fileId, priority);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+RC setPagePriority(BM_BufferPool *const bm, BM_PageHandle *const page, const BM_PagePriority priority) {
+    return setFilePagePriority(bm, page, 0, priority);
+}
+
+static RC pinFilePageLocked(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+                            const PageNumber pageNum, const BM_AccessHint hint) {
+    if (bm == NULL || bm->mgmtData == NULL || page == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+
+    if (pageNum < 0 || !fileIsOpen(pm, fileId)) {
+        STAT_ADD(pm, failedPins, 1);
+        return (pageNum < 0) ? RC_READ_NON_EXISTING_PAGE : RC_BM_INVALID_FILE;
+    }
+
+    TRACE(pm, TRACE_PIN, fileId, pageNum);
+    if (pm->mrc != NULL && mrcSampled(pm->mrc, mrcHash(fileId, pageNum))) mrcAccess(pm->mrc, fileId, pageNum);
+    unsigned long long t0 = LAT_START(pm);
+
+    // If already cached, bump fixCount and return
+    int idx = findFrameIndexByPage(pm, fileId, pageNum);
+    while (idx >= 0 && pm->frames[idx].loading) {
+        // warm-up is reading this page outside the latch; the frame may move once it lands
+        pthread_cond_wait(&pm->loaded, &pm->latch);
+        idx = findFrameIndexByPage(pm, fileId, pageNum);
+    }
+    bool cold = (hint == AH_SCAN || hint == AH_ONCE);
+    if (idx >= 0) {
+        Frame *fr = &pm->frames[idx];
+        fr->fixCount += 1;
+        if (!cold) touchForLRU(pm, fr);
+        else if (fr->prefetched) coldFrame(fr); // no promotion; read-ahead pages go cold once the scan has them
+        fr->prefetched = FALSE;
+        if (hint == AH_KEEP_HOT) protectFrame(pm, fr);
+        STAT_ADD(pm, hits, 1);
+        STAT_ADD(pm, pins, 1);
+        if (pm->numa && fr->node != currentNumaNode()) STAT_ADD(pm, crossNodeHits, 1);
+        page->pageNum = pageNum;
+        page->data = fr->data + 1;
+        page->frameIdx = idx;
+        page->frameGen = fr->gen;
+        LAT_RECORD(pm, LAT_PIN_HIT, t0);
+        return RC_OK;
+    }
+
+    STAT_ADD(pm, misses, 1);
+    checkGhost(pm, fileId, pageNum);
+
+    // Not cached: take an empty frame first, else select a victim according to strategy
+    RC rcLoad;
+    do {
+        idx = pickFrameForLoad(pm, bm->strategy);
+        if (idx < 0) {
+            // No evictable frame (all pinned)
+            STAT_ADD(pm, failedPins, 1);
+            return RC_WRITE_FAILED; // reuse error code to signal inability to pin
+        }
+        // Evict if needed and load requested page; a latch-free pin may take the victim first
+        rcLoad = evictIfNeededAndLoad(pm, idx, fileId, pageNum);
+    } while (rcLoad == RC_BM_PAGE_PINNED);
+    if (rcLoad != RC_OK) {
+        STAT_ADD(pm, failedPins, 1);
+        return rcLoad;
+    }
+
+    // Pin and return handle
+    Frame *fr = &pm->frames[idx];
+    fr->fixCount += 1;
+    if (cold) coldFrame(fr);
+    else touchForLRU(pm, fr);
+    if (hint == AH_KEEP_HOT) protectFrame(pm, fr);
+    STAT_ADD(pm, pins, 1);
+
+    page->pageNum = pageNum;
+    page->data = fr->data + 1;
+    page->frameIdx = idx;
+    page->frameGen = fr->gen;
+    LAT_RECORD(pm, LAT_PIN_MISS, t0);
+    if (hint == AH_SCAN) readAhead(pm, bm->strategy, fileId, pageNum + 1);
+    return RC_OK;
+}
+
+RC pinFilePageHinted(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+                     const PageNumber pageNum, const BM_AccessHint hint) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (hint < AH_NORMAL || hint > AH_KEEP_HOT) return RC_FILE_HANDLE_NOT_INIT;
+    // a resident page under a plain pin needs neither the latch nor any policy work beyond its tick
+    if (hint == AH_NORMAL && page != NULL && pinLatchFree(mgmt(bm), page, fileId, pageNum)) return RC_OK;
+    latchPool(mgmt(bm));
+    RC rc = pinFilePageLocked(bm, page, fileId, pageNum, hint);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+RC pinFilePage(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+               const PageNumber pageNum) {
+    return pinFilePageHinted(bm, page, fileId, pageNum, AH_NORMAL);
+}
+
+static RC pinNewFilePageLocked(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+                               PageNumber *pageNum) {
+    if (bm == NULL || bm->mgmtData == NULL || page == NULL || pageNum == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    if (!fileIsOpen(pm, fileId)) {
+        STAT_ADD(pm, failedPins, 1);
+        return RC_BM_INVALID_FILE;
+    }
+    PoolFile *pf = &pm->files[fileId];
+    if (pf->nextPage < pf->fh.totalNumPages) pf->nextPage = pf->fh.totalNumPages; // pinPage grew the file
+    PageNumber p = pf->nextPage;
+    TRACE(pm, TRACE_PIN, fileId, p);
+
+    int idx;
+    RC rc;
+    do {
+        idx = pickFrameForLoad(pm, bm->strategy);
+        if (idx < 0) {
+            STAT_ADD(pm, failedPins, 1);
+            return RC_WRITE_FAILED;
+        }
+        rc = (pm->frames[idx].pageNum != NO_PAGE) ? evictFrame(pm, &pm->frames[idx]) : RC_OK;
+    } while (rc == RC_BM_PAGE_PINNED);
+    if (rc != RC_OK) {
+        STAT_ADD(pm, failedPins, 1);
+        return rc;
+    }
+    Frame *fr = &pm->frames[idx];
+
+    // nothing on disk to read; the first write-back extends the file
+    memset(fr->data + 1, 0, PAGE_SIZE);
+    rc = tagFrame(pm, fr, fileId, p);
+    if (rc != RC_OK) {
+        STAT_ADD(pm, failedPins, 1);
+        return rc;
+    }
+    fr->dirty = FALSE;
+    markFrameDirty(fr, 0, PAGE_SIZE);
+    fr->fixCount += 1;
+    fr->seq = ++pm->tick;
+    fr->lru = fr->seq;
+    pf->nextPage = p + 1;
+    STAT_ADD(pm, pins, 1);
+    STAT_ADD(pm, newPages, 1);
+
+    page->pageNum = p;
+    page->data = fr->data + 1;
+    page->frameIdx = idx;
+    page->frameGen = fr->gen;
+    *pageNum = p;
+    return RC_OK;
+}
+
+RC pinNewFilePage(BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId, PageNumber *pageNum) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = pinNewFilePageLocked(bm, page, fileId, pageNum);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+RC pinNewPage(BM_BufferPool *const bm, BM_PageHandle *const page, PageNumber *pageNum) {
+    return pinNewFilePage(bm, page, 0, pageNum);
+}
+
+static RC discardFileRangeLocked(BM_BufferPool *const bm, const int fileId, const PageNumber from,
+                                 const PageNumber to) {
+    if (bm == NULL || bm->mgmtData == NULL || from < 0 || to < from) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    if (!fileIsOpen(pm, fileId)) return RC_BM_INVALID_FILE;
+
+    // all or nothing: every frame in the range is claimed before any is dropped
+    if (!claimFileFrames(pm, fileId, from, to)) return RC_BM_PAGE_PINNED; // warm-up loads hold a pin too
+
+    // the frames go straight back to empty: no write-back, no ghost, the page is gone
+    FileFrameIter it;
+    int f;
+    fileFramesBegin(pm, &it, fileId, from, to);
+    while ((f = fileFramesNext(pm, &it)) >= 0) {
+        Frame *fr = &pm->frames[f];
+        if (fr->dirty) STAT_ADD(pm, discardedDirty, 1);
+        STAT_ADD(pm, discarded, 1);
+        clearFrame(pm, fr);
+    }
+    for (int g = 0; g < pm->ghostCap; g++) {
+        Ghost *gh = &pm->ghosts[g];
+        if (gh->fileId == fileId && gh->pageNum >= from && gh->pageNum < to) dropGhost(pm, g);
+    }
+    return RC_OK;
+}
+
+RC discardFileRange(BM_BufferPool *const bm, const int fileId, const PageNumber from, const PageNumber to) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = discardFileRangeLocked(bm, fileId, from, to);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+RC discardRange(BM_BufferPool *const bm, const PageNumber from, const PageNumber to) {
+    return discardFileRange(bm, 0, from, to);
+}
+
+RC discardPage(BM_BufferPool *const bm, const PageNumber pageNum) {
+    if (pageNum < 0 || pageNum == INT_MAX) return RC_FILE_HANDLE_NOT_INIT; // INT_MAX has no exclusive end
+    return discardFileRange(bm, 0, pageNum, pageNum + 1);
+}
+
+// Swizzled child references
+
+static bool validSlot(const int offset) {
+    return offset >= 0 && offset % (int)sizeof(int64_t) == 0 && offset + (int)sizeof(int64_t) <= PAGE_SIZE;
+}
+
+static int swizzledFrame(PoolMgmt *pm, int p, int offset, int64_t v) {
+    // the frame a negative slot names, or -1 when the frame does not link back to the slot:
+    // the page may never have held slots, or the caller overwrote one through its data
+    if (v >= 0 || v < -(int64_t)pm->capacity) return -1;
+    int idx = (int)(-v - 1);
+    Frame *fr = &pm->frames[idx];
+    return (fr->swizParent == p && fr->swizOffset == offset) ? idx : -1;
+}
+
+static int parentFrameOf(PoolMgmt *pm, BM_PageHandle *parent) {
+    // the parent's file comes from its frame; a hand-built handle is taken as file 0
+    int i = parent->frameIdx;
+    int fileId = (i >= 0 && i < pm->capacity) ? pm->frames[i].fileId : 0;
+    return frameOfHandle(pm, parent, fileId);
+}
+
+static RC pinChildLocked(BM_BufferPool *const bm, BM_PageHandle *const parent, const int offset,
+                         BM_PageHandle *const child) {
+    if (bm == NULL || bm->mgmtData == NULL || parent == NULL || child == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (!validSlot(offset)) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    int p = parentFrameOf(pm, parent);
+    if (p < 0) return RC_READ_NON_EXISTING_PAGE;
+    int fileId = pm->frames[p].fileId;
+    int64_t v = atomic_load(slotAt(&pm->frames[p], offset));
+
+    if (v < 0) {
+        // swizzled: the slot names the frame, no lookup
+        int idx = swizzledFrame(pm, p, offset, v);
+        if (idx < 0) return RC_READ_NON_EXISTING_PAGE;
+        Frame *fr = &pm->frames[idx];
+        TRACE(pm, TRACE_PIN, fileId, fr->pageNum);
+        if (pm->mrc != NULL && mrcSampled(pm->mrc, mrcHash(fileId, fr->pageNum))) mrcAccess(pm->mrc, fileId, fr->pageNum);
+        fr->fixCount += 1;
+        touchForLRU(pm, fr);
+        fr->prefetched = FALSE;
+        STAT_ADD(pm, hits, 1);
+        STAT_ADD(pm, pins, 1);
+        FAST_COUNT(pm, swizzledPins);
+        child->pageNum = fr->pageNum;
+        child->data = fr->data + 1;
+        child->frameIdx = idx;
+        child->frameGen = fr->gen;
+        return RC_OK;
+    }
+    if (v > INT_MAX) return RC_READ_NON_EXISTING_PAGE;
+
+    RC rc = pinFilePageLocked(bm, child, fileId, (PageNumber)v, AH_NORMAL);
+    if (rc != RC_OK) return rc;
+    // the first pin through a slot swizzles it; a page already named by another slot, or by its own, stays put.
+    // The parent is pinned, so the load did not take its frame
+    Frame *fr = &pm->frames[child->frameIdx];
+    if (child->frameIdx != p && fr->swizParent < 0) {
+        fr->swizOffset = offset;
+        fr->swizParent = p; // before the slot, so a latch-free pin that finds the slot finds the link
+        atomic_store(slotAt(&pm->frames[p], offset), -(int64_t)child->frameIdx - 1);
+        pm->frames[p].swizChildren += 1;
+    }
+    return RC_OK;
+}
+
+RC pinChild(BM_BufferPool *const bm, BM_PageHandle *const parent, const int offset, BM_PageHandle *const child) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (parent != NULL && child != NULL && validSlot(offset) && pinSwizzledLatchFree(mgmt(bm), parent, offset, child)) {
+        return RC_OK;
+    }
+    latchPool(mgmt(bm));
+    RC rc = pinChildLocked(bm, parent, offset, child);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC childSlotLocked(BM_BufferPool *const bm, BM_PageHandle *const parent, const int offset,
+                          PageNumber *const get, const PageNumber *const set) {
+    if (bm == NULL || bm->mgmtData == NULL || parent == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (!validSlot(offset)) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    int p = parentFrameOf(pm, parent);
+    if (p < 0) return RC_READ_NON_EXISTING_PAGE;
+    _Atomic int64_t *slot = slotAt(&pm->frames[p], offset);
+    int64_t v = atomic_load(slot);
+    int idx = swizzledFrame(pm, p, offset, v);
+    if (v < 0 && idx < 0 && get != NULL) return RC_READ_NON_EXISTING_PAGE; // a set may overwrite garbage
+    Frame *c = (idx >= 0) ? &pm->frames[idx] : NULL;
+    if (get != NULL) *get = (c != NULL) ? c->pageNum : (PageNumber)v;
+    if (set != NULL) {
+        // the slot first, then the link: a latch-free pin that read the old slot may still take the old child
+        atomic_store(slot, (int64_t)*set);
+        if (c != NULL) {
+            c->swizParent = -1;
+            pm->frames[p].swizChildren -= 1;
+        }
+    }
+    return RC_OK;
+}
+
+RC getChildPageNum(BM_BufferPool *const bm, BM_PageHandle *const parent, const int offset, PageNumber *pageNum) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (pageNum == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = childSlotLocked(bm, parent, offset, pageNum, NULL);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+RC setChildPageNum(BM_BufferPool *const bm, BM_PageHandle *const parent, const int offset, const PageNumber pageNum) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (pageNum < 0) return RC_READ_NON_EXISTING_PAGE;
+    latchPool(mgmt(bm));
+    RC rc = childSlotLocked(bm, parent, offset, NULL, &pageNum);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page) {
+    return markFileDirty(bm, page, 0);
+}
+
+RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page) {
+    return unpinFilePage(bm, page, 0);
+}
+
+RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page) {
+    return forceFilePage(bm, page, 0);
+}
+
+RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
+           const PageNumber pageNum) {
+    return pinFilePage(bm, page, 0, pageNum);
+}
+
+RC pinPageHinted(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum,
+                 const BM_AccessHint hint) {
+    return pinFilePageHinted(bm, page, 0, pageNum, hint);
+}
+
+// Batch pin/unpin
+
+static int byBatchPage(const void *a, const void *b) {
+    const BatchPin *x = (const BatchPin*)a, *y = (const BatchPin*)b;
+    if (x->pageNum != y->pageNum) return (x->pageNum < y->pageNum) ? -1 : 1;
+    return (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+static RC readBatchMisses(PoolMgmt *pm, BatchPin *b, int n, int fileId) {
+    SM_FileHandle *fh = &pm->files[fileId].fh;
+    PageNumber last = -1;
+    for (int i = 0; i < n; i++) {
+        if (b[i].miss && b[i].pageNum > last) last = b[i].pageNum;
+    }
+    if (last >= fh->totalNumPages) {
+        RC rc = ensureCapacity(last + 1, fh);
+        if (rc != RC_OK) return rc;
+    }
+
+    // misses are distinct and in page order: each run of consecutive pages is one vectored read
+    int i = 0;
+    while (i < n) {
+        if (!b[i].miss || b[i].read) {
+            i++;
+            continue;
+        }
+        SM_PageHandle bufs[PIN_BATCH_RUN];
+        int members[PIN_BATCH_RUN];
+        PageNumber first = b[i].pageNum;
+        int run = 0;
+        for (; i < n && run < PIN_BATCH_RUN; i++) {
+            if (!b[i].miss) continue; // a duplicate of the page before
+            if (b[i].pageNum != first + run) break;
+            bufs[run] = pm->frames[b[i].frame].data + 1;
+            members[run++] = i;
+        }
+        unsigned long long t0 = LAT_START(pm);
+        RC rc = readBlocks(first, run, fh, bufs);
+        if (rc != RC_OK) return rc;
+        LAT_RECORD(pm, LAT_MISS_READ, t0);
+        STAT_ADD(pm, readIO, run);
+        STAT_ADD(pm, bytesRead, (uint64_t)run * PAGE_SIZE);
+        for (int m = 0; m < run; m++) b[members[m]].read = TRUE;
+    }
+    return RC_OK;
+}
+
+static RC pinPagesLocked(BM_BufferPool *const bm, BM_PageHandle *const pages, const PageNumber *const pageNums,
+                         const int numPages, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL || pages == NULL || pageNums == NULL || numPages < 0) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    if (!fileIsOpen(pm, fileId)) {
+        STAT_ADD(pm, failedPins, numPages);
+        return RC_BM_INVALID_FILE;
+    }
+    for (int i = 0; i < numPages; i++) {
+        if (pageNums[i] < 0) {
+            STAT_ADD(pm, failedPins, numPages);
+            return RC_READ_NON_EXISTING_PAGE;
+        }
+    }
+    if (numPages == 0) return RC_OK;
+
+    BatchPin stackPins[PIN_BATCH_STACK];
+    BatchPin *b = (numPages <= PIN_BATCH_STACK) ? stackPins : (BatchPin*)malloc(sizeof(BatchPin) * numPages);
+    if (b == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    for (int i = 0; i < numPages; i++) {
+        TRACE(pm, TRACE_PIN, fileId, pageNums[i]);
+        if (pm->mrc != NULL && mrcSampled(pm->mrc, mrcHash(fileId, pageNums[i]))) mrcAccess(pm->mrc, fileId, pageNums[i]);
+        b[i].pageNum = pageNums[i];
+        b[i].pos = i;
+    }
+    if (numPages > PIN_BATCH_STACK) {
+        qsort(b, numPages, sizeof(BatchPin), byBatchPage);
+    } else {
+        for (int i = 1; i < numPages; i++) { // short batches: insertion sort beats qsort's callbacks
+            BatchPin x = b[i];
+            int j = i;
+            for (; j > 0 && byBatchPage(&b[j - 1], &x) > 0; j--) b[j] = b[j - 1];
+            b[j] = x;
+        }
+    }
+
+    // one page-table lookup per distinct page finds every hit; a page warm-up is still reading restarts it
+    bool loading;
+    do {
+        loading = FALSE;
+        for (int i = 0; i < numPages; i++) {
+            b[i].frame = -1;
+            b[i].miss = FALSE;
+            b[i].read = FALSE;
+        }
+        for (int i = 0; i < numPages && !loading; i++) {
+            if (i > 0 && b[i].pageNum == b[i - 1].pageNum) {
+                b[i].frame = b[i - 1].frame;
+                continue;
+            }
+            int f = findFrameIndexByPage(pm, fileId, b[i].pageNum);
+            if (f < 0) continue;
+            if (pm->frames[f].loading) loading = TRUE;
+            b[i].frame = f;
+        }
+        if (loading) pthread_cond_wait(&pm->loaded, &pm->latch);
+    } while (loading);
+
+    // pin the hits first so that victim selection for the misses cannot take them
+    for (int i = 0; i < numPages; i++) {
+        if (b[i].frame < 0) continue;
+        pm->frames[b[i].frame].fixCount += 1;
+        STAT_ADD(pm, hits, 1);
+    }
+
+    RC rc = RC_OK;
+    for (int i = 0; i < numPages && rc == RC_OK; i++) {
+        if (b[i].frame >= 0) continue;
+        if (i > 0 && b[i - 1].pageNum == b[i].pageNum) { // the same page twice shares its frame
+            b[i].frame = b[i - 1].frame;
+            pm->frames[b[i].frame].fixCount += 1;
+            STAT_ADD(pm, hits, 1);
+            continue;
+        }
+        STAT_ADD(pm, misses, 1);
+        checkGhost(pm, fileId, b[i].pageNum);
+        int idx;
+        do {
+            idx = pickFrameForLoad(pm, bm->strategy);
+            if (idx < 0) break;
+            rc = (pm->frames[idx].pageNum != NO_PAGE) ? evictFrame(pm, &pm->frames[idx]) : RC_OK;
+        } while (rc == RC_BM_PAGE_PINNED); // a latch-free pin took the victim
+        if (idx < 0) {
+            rc = RC_WRITE_FAILED; // every frame pinned, as in pinPage
+            break;
+        }
+        if (rc != RC_OK) break;
+        Frame *fr = &pm->frames[idx];
+        fr->loading = TRUE; // latch-free pins back off until the read lands
+        rc = tagFrame(pm, fr, fileId, b[i].pageNum);
+        if (rc != RC_OK) {
+            fr->loading = FALSE;
+            break;
+        }
+        fr->dirty = FALSE;
+        fr->fixCount += 1;
+        b[i].frame = idx;
+        b[i].miss = TRUE;
+    }
+    if (rc == RC_OK) rc = readBatchMisses(pm, b, numPages, fileId);
+
+    if (rc != RC_OK) {
+        // all or nothing: drop this call's pins, repeated pages included, then the frames whose
+        // read never happened; a frame is claimable only once every entry sharing it has let go
+        for (int i = 0; i < numPages; i++) {
+            if (b[i].frame >= 0) unfixFrame(&pm->frames[b[i].frame]);
+        }
+        for (int i = 0; i < numPages; i++) {
+            if (b[i].frame < 0) continue;
+            Frame *fr = &pm->frames[b[i].frame];
+            if (b[i].miss && !b[i].read && fr->pageNum != NO_PAGE) {
+                claimFrameWait(fr);
+                clearFrame(pm, fr);
+            }
+            if (b[i].miss) fr->loading = FALSE;
+        }
+        STAT_ADD(pm, failedPins, numPages);
+    } else {
+        // one policy update for the whole batch
+        unsigned long long now = ++pm->tick;
+        for (int i = 0; i < numPages; i++) {
+            Frame *fr = &pm->frames[b[i].frame];
+            if (b[i].miss) fr->seq = now;
+            fr->lru = now;
+            if (b[i].miss) fr->loading = FALSE;
+            BM_PageHandle *h = &pages[b[i].pos];
+            h->pageNum = b[i].pageNum;
+            h->data = fr->data + 1;
+            h->frameIdx = b[i].frame;
+            h->frameGen = fr->gen;
+        }
+        STAT_ADD(pm, pins, numPages);
+    }
+    if (b != stackPins) free(b);
+    return rc;
+}
+
+RC pinPages(BM_BufferPool *const bm, BM_PageHandle *const pages, const PageNumber *const pageNums,
+            const int numPages) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = pinPagesLocked(bm, pages, pageNums, numPages, 0);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC unpinPagesLocked(BM_BufferPool *const bm, BM_PageHandle *const pages, const int numPages, const int fileId) {
+    if (bm == NULL || bm->mgmtData == NULL || pages == NULL || numPages < 0) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    RC rc = RC_OK;
+    bool drain = FALSE;
+    for (int i = 0; i < numPages; i++) {
+        TRACE(pm, TRACE_UNPIN, fileId, pages[i].pageNum);
+        int idx = frameOfHandle(pm, &pages[i], fileId);
+        if (idx < 0) {
+            if (rc == RC_OK) rc = RC_READ_NON_EXISTING_PAGE; // report the first, unpin the rest
+            continue;
+        }
+        unfixFrame(&pm->frames[idx]);
+        STAT_ADD(pm, unpins, 1);
+        if (idx >= pm->target && pm->frames[idx].fixCount == 0) drain = TRUE;
+    }
+    if (drain) {
+        RC rcDrain = drainRetiringFrames(pm, bm->strategy);
+        bm->numPages = pm->capacity;
+        if (rc == RC_OK) rc = rcDrain;
+    }
+    return rc;
+}
+
+RC unpinPages(BM_BufferPool *const bm, BM_PageHandle *const pages, const int numPages) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = unpinPagesLocked(bm, pages, numPages, 0);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+// Statistics API
+
+PageNumber *getFrameContents(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) return NULL;
     PoolMgmt *pm = mgmt(bm);
+    latchPool(pm);
     PageNumber *arr = (PageNumber*)malloc(sizeof(PageNumber) * pm->capacity);
-    if (arr == NULL) return NULL;
-    for (int i = 0; i < pm->capacity; i++) {
+    for (int i = 0; arr != NULL && i < pm->capacity; i++) {
         arr[i] = pm->frames[i].pageNum;
     }
+    unlatchPool(pm);
     return arr;
 }
 
 bool *getDirtyFlags(BM_BufferPool *const bm) {
     if (bm == NULL || bm->mgmtData == NULL) return NULL;
     PoolMgmt *pm = mgmt(bm);
+    latchPool(pm);
     bool *arr = (bool*)malloc(sizeof(bool) * pm->capacity);
-    if (arr == NULL) return NULL;
-    for (int i = 0; i < pm->capacity; i++) {
+    for (int i = 0; arr != NULL && i < pm->capacity; i++) {
         arr[i] = pm->frames[i].dirty ? TRUE : FALSE;
     }
+    unlatchPool(pm);
     return arr;
 }
 
 int *getFixCounts(BM_BufferPool *const bm) {
     if (bm == NULL || bm->mgmtData == NULL) return NULL;
     PoolMgmt *pm = mgmt(bm);
+    latchPool(pm);
     int *arr = (int*)malloc(sizeof(int) * pm->capacity);
-    if (arr == NULL) return NULL;
-    for (int i = 0; i < pm->capacity; i++) {
+    for (int i = 0; arr != NULL && i < pm->capacity; i++) {
         arr[i] = pm->frames[i].fixCount;
     }
+    unlatchPool(pm);
     return arr;
 }
 
-int getNumReadIO(BM_BufferPool *const bm) {
+static RC getFrameSnapshotLocked(BM_BufferPool *const bm, const int firstFrame, BM_FrameInfo *const out,
+                                  const int maxFrames, int *numFilled) {
+    if (bm == NULL || bm->mgmtData == NULL || out == NULL || numFilled == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (firstFrame < 0 || maxFrames < 0) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    int n = 0;
+    for (int i = firstFrame; i < pm->capacity && n < maxFrames; i++, n++) {
+        Frame *fr = &pm->frames[i];
+        out[n].pageNum = fr->pageNum;
+        out[n].fileId = fr->fileId;
+        out[n].fixCount = fr->fixCount;
+        out[n].dirty = fr->dirty ? TRUE : FALSE;
+        out[n].dirtyFrom = fr->dirty ? fr->dirtyFrom : 0;
+        out[n].dirtyTo = fr->dirty ? fr->dirtyTo : 0;
+        out[n].node = fr->node;
+        out[n].priority = fr->priority;
+    }
+    *numFilled = n;
+    return RC_OK;
+}
+
+RC getFrameSnapshot(BM_BufferPool *const bm, const int firstFrame, BM_FrameInfo *const out,
+                    const int maxFrames, int *numFilled) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = getFrameSnapshotLocked(bm, firstFrame, out, maxFrames, numFilled);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static int ioCount(BM_BufferPool *const bm, bool writes) {
+    // the 64-bit counters are read under the latch and saturate in the legacy int
     if (bm == NULL || bm->mgmtData == NULL) return -1;
-    return mgmt(bm)->numReadIO;
+    PoolMgmt *pm = mgmt(bm);
+    latchPool(pm);
+    uint64_t n = writes ? STAT_TOTAL(pm, writeIO) : STAT_TOTAL(pm, readIO);
+    unlatchPool(pm);
+    return (n > (uint64_t)INT_MAX) ? INT_MAX : (int)n;
+}
+
+int getNumReadIO(BM_BufferPool *const bm) {
+    return ioCount(bm, FALSE);
 }
 
 int getNumWriteIO(BM_BufferPool *const bm) {
+    return ioCount(bm, TRUE);
+}
+
+FrameBacking getFrameBacking(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) return FB_DEFAULT;
+    PoolMgmt *pm = mgmt(bm);
+    // report the weakest backing any partition ended up with
+    FrameBacking weakest = FB_HUGE_1GB;
+    for (int sg = 0; sg < pm->numSegments; sg++) {
+        if (pm->segments[sg].arena.backing < weakest) weakest = pm->segments[sg].arena.backing;
+    }
+    return (pm->numSegments > 0) ? weakest : FB_DEFAULT;
+}
+
+int getNumaPartitions(BM_BufferPool *const bm) {
     if (bm == NULL || bm->mgmtData == NULL) return -1;
-    return mgmt(bm)->numWriteIO;
+    PoolMgmt *pm = mgmt(bm);
+    if (!pm->numa) return 1;
+    return (pm->numNodes < pm->capacity) ? pm->numNodes : pm->capacity;
+}
+
+unsigned long long getNumCrossNodeHits(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) return 0ULL;
+    latchPool(mgmt(bm));
+    unsigned long long n = STAT_TOTAL(mgmt(bm), crossNodeHits);
+    unlatchPool(mgmt(bm));
+    return n;
+}
+
+static RC setGhostListSizeLocked(BM_BufferPool *const bm, const int numGhosts) {
+    if (bm == NULL || bm->mgmtData == NULL || numGhosts < 0) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+
+    Ghost *ghosts = NULL;
+    int *heads = NULL;
+    uint64_t chains = 16;
+    if (numGhosts > 0) {
+        while (chains < (uint64_t)numGhosts) chains <<= 1;
+        ghosts = (Ghost*)malloc(sizeof(Ghost) * numGhosts);
+        heads = (int*)malloc(sizeof(int) * chains);
+        if (ghosts == NULL || heads == NULL) {
+            free(ghosts);
+            free(heads);
+            return RC_FILE_HANDLE_NOT_INIT;
+        }
+        for (int i = 0; i < numGhosts; i++) {
+            ghosts[i].pageNum = NO_PAGE;
+            ghosts[i].evictNo = 0;
+            ghosts[i].next = -1;
+        }
+        for (uint64_t c = 0; c < chains; c++) heads[c] = -1;
+    }
+    free(pm->ghosts);
+    free(pm->ghostHeads);
+    pm->ghosts = ghosts;
+    pm->ghostHeads = heads;
+    pm->ghostMask = chains - 1;
+    pm->ghostCap = numGhosts;
+    pm->evictions = 0;
+    memset(pm->ghostHist, 0, sizeof(pm->ghostHist));
+    return RC_OK;
+}
+
+RC setGhostListSize(BM_BufferPool *const bm, const int numGhosts) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = setGhostListSizeLocked(bm, numGhosts);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static unsigned long long getGhostHitsLocked(BM_BufferPool *const bm, const int extraFrames) {
+    if (bm == NULL || bm->mgmtData == NULL || extraFrames <= 0) return 0ULL;
+    PoolMgmt *pm = mgmt(bm);
+    if (pm->ghosts == NULL) return 0ULL;
+
+    // bucket b holds distances [b * cap / B, (b + 1) * cap / B); take a share of the bucket cut by extraFrames
+    double hits = 0.0;
+    for (int b = 0; b < GHOST_BUCKETS; b++) {
+        double lo = (double)b * pm->ghostCap / GHOST_BUCKETS;
+        double hi = (double)(b + 1) * pm->ghostCap / GHOST_BUCKETS;
+        if (hi <= extraFrames) {
+            hits += (double)pm->ghostHist[b];
+        } else if (lo < extraFrames) {
+            hits += (double)pm->ghostHist[b] * (extraFrames - lo) / (hi - lo);
+        }
+    }
+    return (unsigned long long)(hits + 0.5);
+}
+
+unsigned long long getGhostHits(BM_BufferPool *const bm, const int extraFrames) {
+    if (bm == NULL || bm->mgmtData == NULL) return 0ULL;
+    // misses record into the histogram, and setGhostListSize swaps the ring, under the latch
+    latchPool(mgmt(bm));
+    unsigned long long hits = getGhostHitsLocked(bm, extraFrames);
+    unlatchPool(mgmt(bm));
+    return hits;
+}
+
+static RC getPoolStatsLocked(BM_BufferPool *const bm, BM_Stats *const stats) {
+    if (bm == NULL || bm->mgmtData == NULL || stats == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    // every field is a uint64_t, so the shards add up word by word
+    memset(stats, 0, sizeof(BM_Stats));
+    for (int s = 0; s < STAT_SHARDS; s++) {
+        const uint64_t *in = (const uint64_t*)&pm->shards[s].stats;
+        for (size_t k = 0; k < sizeof(BM_Stats) / sizeof(uint64_t); k++) ((uint64_t*)stats)[k] += in[k];
+        stats->latchFreePins += atomic_load(&pm->shards[s].fastPins);
+        stats->latchFreeUnpins += atomic_load(&pm->shards[s].fastUnpins);
+        stats->swizzledPins += atomic_load(&pm->shards[s].swizzledPins);
+    }
+    stats->hits += stats->latchFreePins;
+    stats->pins += stats->latchFreePins;
+    stats->unpins += stats->latchFreeUnpins;
+    // occupancy is a gauge, counted at read time rather than kept up on every load and eviction
+    memset(stats->classFrames, 0, sizeof(stats->classFrames));
+    for (int i = 0; i < pm->capacity; i++) {
+        if (pm->frames[i].pageNum != NO_PAGE) stats->classFrames[pm->frames[i].priority] += 1;
+    }
+    return RC_OK;
+}
+
+RC getPoolStats(BM_BufferPool *const bm, BM_Stats *const stats) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = getPoolStatsLocked(bm, stats);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC resetPoolStatsLocked(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    for (int s = 0; s < STAT_SHARDS; s++) {
+        memset(&mgmt(bm)->shards[s].stats, 0, sizeof(BM_Stats));
+        atomic_store(&mgmt(bm)->shards[s].fastPins, 0);
+        atomic_store(&mgmt(bm)->shards[s].fastUnpins, 0);
+        atomic_store(&mgmt(bm)->shards[s].swizzledPins, 0);
+    }
+    return RC_OK;
+}
+
+RC resetPoolStats(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = resetPoolStatsLocked(bm);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC setLatencyTrackingLocked(BM_BufferPool *const bm, const bool enabled) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    if (!enabled) {
+        free(pm->latency);
+        pm->latency = NULL;
+        return RC_OK;
+    }
+    if (pm->latency != NULL) return RC_OK;
+    pm->latency = (LatencyHist*)calloc(LAT_NUM_OPS, sizeof(LatencyHist));
+    return (pm->latency != NULL) ? RC_OK : RC_FILE_HANDLE_NOT_INIT;
+}
+
+RC setLatencyTracking(BM_BufferPool *const bm, const bool enabled) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = setLatencyTrackingLocked(bm, enabled);
+    updateFastPath(mgmt(bm));
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC getLatencySummaryLocked(BM_BufferPool *const bm, const BM_LatencyOp op, BM_LatencySummary *const out) {
+    if (bm == NULL || bm->mgmtData == NULL || out == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (op < 0 || op >= LAT_NUM_OPS) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    memset(out, 0, sizeof(BM_LatencySummary));
+    if (pm->latency == NULL) return RC_OK;
+
+    LatencyHist *h = &pm->latency[op];
+    out->count  = h->total;
+    out->meanNs = (h->total > 0) ? h->sumNs / h->total : 0;
+    out->p50Ns  = lhPercentile(h, 0.50);
+    out->p99Ns  = lhPercentile(h, 0.99);
+    out->p999Ns = lhPercentile(h, 0.999);
+    out->maxNs  = h->maxNs;
+    return RC_OK;
+}
+
+RC getLatencySummary(BM_BufferPool *const bm, const BM_LatencyOp op, BM_LatencySummary *const out) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = getLatencySummaryLocked(bm, op, out);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+// Access tracing
+
+static RC startAccessTraceLocked(BM_BufferPool *const bm, const char *const traceFile, const int ringRecords) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    if (pm->trace != NULL) return RC_FILE_HANDLE_NOT_INIT;
+    return openAccessTrace(&pm->trace, traceFile, ringRecords);
+}
+
+RC startAccessTrace(BM_BufferPool *const bm, const char *const traceFile, const int ringRecords) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = startAccessTraceLocked(bm, traceFile, ringRecords);
+    updateFastPath(mgmt(bm));
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC flushAccessTraceLocked(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL || mgmt(bm)->trace == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    return drainAccessTrace(mgmt(bm)->trace);
+}
+
+RC flushAccessTrace(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    // stopAccessTrace frees the trace under the latch
+    latchPool(mgmt(bm));
+    RC rc = flushAccessTraceLocked(bm);
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC stopAccessTraceLocked(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL || mgmt(bm)->trace == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    RC rc = closeAccessTrace(pm->trace);
+    pm->trace = NULL;
+    return rc;
+}
+
+RC stopAccessTrace(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = stopAccessTraceLocked(bm);
+    updateFastPath(mgmt(bm));
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+unsigned long long getNumTraceDropped(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) return 0ULL;
+    latchPool(mgmt(bm));
+    unsigned long long n = getTraceDropped(mgmt(bm)->trace);
+    unlatchPool(mgmt(bm));
+    return n;
+}
+
+// Miss-ratio curve
+
+static RC setMissRatioTrackingLocked(BM_BufferPool *const bm, const double samplingRate) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    if (pm->mrc != NULL) {
+        freeMrcSampler(pm->mrc);
+        free(pm->mrc);
+        pm->mrc = NULL;
+    }
+    if (samplingRate <= 0.0) return RC_OK;
+
+    MrcSampler *s = (MrcSampler*)malloc(sizeof(MrcSampler));
+    if (s == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    RC rc = initMrcSampler(s, samplingRate);
+    if (rc != RC_OK) {
+        free(s);
+        return rc;
+    }
+    pm->mrc = s;
+    return RC_OK;
+}
+
+RC setMissRatioTracking(BM_BufferPool *const bm, const double samplingRate) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    (void)pauseFastPath(mgmt(bm)); // latch-free hits feed the sampler about to be replaced
+    RC rc = setMissRatioTrackingLocked(bm, samplingRate);
+    updateFastPath(mgmt(bm));
+    unlatchPool(mgmt(bm));
+    return rc;
+}
+
+static RC getMissRatioCurveLocked(BM_BufferPool *const bm, BM_MissRatioCurve *const curve) {
+    static const double scale[BM_MRC_POINTS] = {0.25, 0.5, 0.75, 1.0, 1.5, 2.0, 3.0, 4.0};
+    if (bm == NULL || bm->mgmtData == NULL || curve == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    PoolMgmt *pm = mgmt(bm);
+    if (pm->mrc == NULL) return RC_FILE_HANDLE_NOT_INIT;
+
+    curve->numPoints = BM_MRC_POINTS;
+    curve->samples = mrcSamples(pm->mrc);
+    for (int i = 0; i < BM_MRC_POINTS; i++) {
+        int frames = (int)(scale[i] * bm->numPages + 0.5);
+        curve->frames[i] = (frames > 0) ? frames : 1;
+        curve->hitRatio[i] = mrcHitRatio(pm->mrc, curve->frames[i]);
+    }
+    return RC_OK;
+}
+
+RC getMissRatioCurve(BM_BufferPool *const bm, BM_MissRatioCurve *const curve) {
+    if (bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    latchPool(mgmt(bm));
+    RC rc = getMissRatioCurveLocked(bm, curve);
+    unlatchPool(mgmt(bm));
+    return rc;
 }
@@ -7,6 +7,8 @@
 // Include bool DT
 #include "dt.h"
 
+#include <stdint.h>
+
 // Replacement Strategies
 typedef enum ReplacementStrategy {
 	RS_FIFO = 0,
@@ -16,6 +18,31 @@ typedef enum ReplacementStrategy {
 	RS_LRU_K = 4
 } ReplacementStrategy;
 
+// Frame memory backing
+typedef enum FrameBacking {
+	FB_DEFAULT = 0,   // regular pages
+	FB_THP = 1,       // transparent huge pages (madvise)
+	FB_HUGE_2MB = 2,  // MAP_HUGETLB, 2MB pages
+	FB_HUGE_1GB = 3   // MAP_HUGETLB, 1GB pages
+} FrameBacking;
+
+// Access-pattern hints for pinPageHinted
+typedef enum BM_AccessHint {
+	AH_NORMAL = 0,
+	AH_SCAN = 1,      // sequential scan: cold end, no promotion, a miss reads the next pages ahead
+	AH_RANDOM = 2,    // normal placement, never reads ahead
+	AH_ONCE = 3,      // used once: cold end, no promotion
+	AH_KEEP_HOT = 4   // protected segment: evicted only when nothing else is evictable
+} BM_AccessHint;
+
+// Page priority classes (setPagePriority); lower classes are evicted first
+typedef enum BM_PagePriority {
+	PP_LOW = 0,
+	PP_NORMAL = 1,    // every page starts here
+	PP_HIGH = 2,      // B-tree roots, catalog pages: kept in the reserved region
+	BM_NUM_PRIORITIES = 3
+} BM_PagePriority;
+
 // Data Types and Structures
 typedef int PageNumber;
 #define NO_PAGE -1
@@ -28,24 +55,130 @@ typedef struct BM_BufferPool {
 	// manager needs for a buffer pool
 } BM_BufferPool;
 
+// optional settings for initBufferPoolWithOptions; zero-initialize for defaults
+typedef struct BM_PoolOptions {
+	FrameBacking backing; // requested; falls back when the kernel can't provide it
+	bool numaAware;       // split frames into node-local partitions, load near the pinning thread
+	bool concurrent;      // safe to call from many threads; calls serialize on one pool latch,
+	                      // except hits and clean unpins, which go through a lock-free page table
+	bool warmup;          // shutdown saves the resident pages to <pageFile>.warm, init reloads them
+	                      // in the background; implies concurrent
+	double highPriorityShare; // fraction of the frames PP_HIGH pages may hold, 0 for the default 1/4
+} BM_PoolOptions;
+
+// called by forceFlushPoolWithOptions after each batch, one call at a time, without the pool latch
+typedef void (*BM_FlushProgress)(uint64_t pagesDone, uint64_t pagesTotal, void *arg);
+
+// optional settings for forceFlushPoolWithOptions; zero-initialize for defaults
+typedef struct BM_FlushOptions {
+	int numThreads;   // writer threads, the caller included; 0 or 1 writes on the caller only
+	int ioDepth;      // pages per batch and per vectored write, 0 for the default 32
+	BM_FlushProgress progress; // may be NULL; may pin and unpin pages of the pool
+	void *progressArg;
+} BM_FlushOptions;
+
+// a handle built by hand (not by MAKE_PAGE_HANDLE or a pin) must start zeroed, then get its pageNum
 typedef struct BM_PageHandle {
 	PageNumber pageNum;
 	char *data;
+	int frameIdx;           // set by pin, opaque; unpin/markDirty/forcePage go straight to the frame
+	unsigned int frameGen;  // checked against the frame; hand-built handles fall back to the lookup
 } BM_PageHandle;
 
+// pool counters; 64-bit so long-running pools never wrap
+typedef struct BM_Stats {
+	uint64_t hits;            // pins that found the page cached
+	uint64_t misses;          // pins that had to load the page
+	uint64_t evictionsClean;  // pages dropped to make room without a write
+	uint64_t evictionsDirty;  // pages written back to make room
+	uint64_t flushes;         // write-backs by forcePage/forceFlushPool/flushPoolFile/shutdown
+	uint64_t pins;            // successful pins
+	uint64_t unpins;
+	uint64_t failedPins;      // pins that returned an error
+	uint64_t readIO;          // pages read from disk
+	uint64_t writeIO;         // pages written to disk
+	uint64_t bytesRead;
+	uint64_t bytesWritten;
+	uint64_t crossNodeHits;   // NUMA mode: hits on a frame remote to the pinning thread
+	uint64_t latchAcquires;   // concurrent mode: pool latch taken
+	uint64_t latchContended;  // concurrent mode: of those, had to wait
+	uint64_t latchWaitNs;     // concurrent mode: total time spent waiting
+	uint64_t latchFreePins;   // concurrent mode: hits served without the latch (also in hits, pins)
+	uint64_t latchFreeUnpins; // concurrent mode: unpins done without the latch (also in unpins)
+	uint64_t warmupLoaded;    // pages reloaded from the warm-up sidecar (also counted in readIO)
+	uint64_t newPages;        // pages created by pinNewPage, never read
+	uint64_t discarded;       // pages dropped by discardPage/discardRange
+	uint64_t discardedDirty;  // of those, dirty ones whose write-back was skipped
+	uint64_t readAhead;       // pages read ahead of a scan-hinted miss (also counted in readIO)
+	uint64_t swizzledPins;    // pinChild calls served through a swizzled slot (also in hits, pins)
+	uint64_t unswizzled;      // swizzled slots given back their page number as a page left the pool
+	uint64_t classFrames[BM_NUM_PRIORITIES]; // frames holding a page of each class right now
+} BM_Stats;
+
+// latency tracking (setLatencyTracking), one histogram per operation
+typedef enum BM_LatencyOp {
+	LAT_PIN_HIT = 0,
+	LAT_PIN_MISS = 1,          // whole miss, including the two parts below
+	LAT_MISS_EVICT_WRITE = 2,  // writing back a dirty victim
+	LAT_MISS_READ = 3,         // reading the requested page
+	LAT_FORCE_PAGE = 4,
+	LAT_FORCE_FLUSH_POOL = 5,
+	LAT_NUM_OPS = 6
+} BM_LatencyOp;
+
+typedef struct BM_LatencySummary {
+	uint64_t count;
+	uint64_t meanNs;
+	uint64_t p50Ns;
+	uint64_t p99Ns;
+	uint64_t p999Ns;
+	uint64_t maxNs;
+} BM_LatencySummary;
+
+// one frame as seen by getFrameSnapshot
+typedef struct BM_FrameInfo {
+	PageNumber pageNum;  // NO_PAGE when the frame is empty
+	int fileId;
+	int fixCount;
+	bool dirty;
+	int dirtyFrom;       // while dirty: bytes [dirtyFrom, dirtyTo) modified since the last write-back
+	int dirtyTo;
+	int node;            // NUMA node of the frame memory
+	BM_PagePriority priority;
+} BM_FrameInfo;
+
+// predicted LRU hit ratio at other pool sizes (getMissRatioCurve)
+#define BM_MRC_POINTS 8
+typedef struct BM_MissRatioCurve {
+	int numPoints;
+	int frames[BM_MRC_POINTS];      // 0.25x, 0.5x, 0.75x, 1x, 1.5x, 2x, 3x, 4x of numPages
+	double hitRatio[BM_MRC_POINTS];
+	uint64_t samples;               // sampled references behind the estimate
+} BM_MissRatioCurve;
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
 
 #define MAKE_PAGE_HANDLE()				\
-		((BM_PageHandle *) malloc (sizeof(BM_PageHandle)))
+		((BM_PageHandle *) calloc (1, sizeof(BM_PageHandle)))
 
 // Buffer Manager Interface Pool Handling
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData);
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+		const int numPages, ReplacementStrategy strategy,
+		void *stratData, const BM_PoolOptions *const opts);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+// the flush writes in parallel batches; pins and unpins of other pages go on meanwhile, and
+// pages dirtied during the flush stay dirty
+RC forceFlushPoolWithOptions(BM_BufferPool *const bm, const BM_FlushOptions *const opts);
+// blocks until the background warm-up reload is done; returns at once when none is running
+RC waitForWarmup(BM_BufferPool *const bm);
+// grows at once; a shrink finishes as pinned frames are unpinned (bm->numPages tracks progress)
+RC resizeBufferPool(BM_BufferPool *const bm, const int newNumPages);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -53,12 +186,96 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+// pinPage with a hint on how the caller will use the page; AH_NORMAL is plain pinPage
+RC pinPageHinted (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum,
+		const BM_AccessHint hint);
+// tags a pinned page; the class lasts while the page stays resident. PP_HIGH pages are only
+// evicted when no lower victim exists, and fails with RC_BM_BUDGET_EXCEEDED once they fill the share
+RC setPagePriority (BM_BufferPool *const bm, BM_PageHandle *const page, const BM_PagePriority priority);
+// markDirty + unpinPage in one call; the range form records which bytes changed
+RC unpinPageDirty (BM_BufferPool *const bm, BM_PageHandle *const page, const bool dirty);
+RC unpinPageDirtyRange (BM_BufferPool *const bm, BM_PageHandle *const page, const int offset,
+		const int length);
+// numPages pins under one latch: one pass over the frames, one vectored read per run of missing
+// pages, one policy update. All or nothing: on error no page of the call stays pinned
+RC pinPages (BM_BufferPool *const bm, BM_PageHandle *const pages, const PageNumber *const pageNums,
+		const int numPages);
+RC unpinPages (BM_BufferPool *const bm, BM_PageHandle *const pages, const int numPages);
+// appends: pins the next page number past the end of the file as a zeroed, dirty frame
+// without any I/O; the file grows when the page is written back
+RC pinNewPage (BM_BufferPool *const bm, BM_PageHandle *const page, PageNumber *pageNum);
+
+// drop cached pages without writing them back, for truncated or dropped data; pages that are
+// not resident are fine. Fails with RC_BM_PAGE_PINNED, dropping nothing, if one is pinned
+RC discardPage (BM_BufferPool *const bm, const PageNumber pageNum);
+RC discardRange (BM_BufferPool *const bm, const PageNumber from, const PageNumber to); // [from, to)
+
+// Swizzled child references, for trees built on the pool: a child slot is 8 bytes at an 8-aligned
+// offset of a page and holds the child's PageNumber as an int64_t. pinChild pins the child (in the
+// parent's file) of a pinned parent and, while the child stays resident, turns the slot into a
+// direct reference to its frame, so later pins through it skip the page lookup. The slot gets its
+// page number back when the child leaves the pool, and write-backs always carry page numbers.
+// A page is swizzled into at most one slot. Read and change slots through these calls only; a
+// negative slot that is not a live reference fails pinChild and getChildPageNum, setChildPageNum fixes it
+RC pinChild (BM_BufferPool *const bm, BM_PageHandle *const parent, const int offset, BM_PageHandle *const child);
+RC getChildPageNum (BM_BufferPool *const bm, BM_PageHandle *const parent, const int offset, PageNumber *pageNum);
+RC setChildPageNum (BM_BufferPool *const bm, BM_PageHandle *const parent, const int offset,
+		const PageNumber pageNum); // mark the parent dirty as for any write
+
+// Multi-file Interface: one pool caches pages of many files, tagged (fileId, pageNum).
+// The pageFile given to initBufferPool is fileId 0; the plain page calls above act on it.
+RC openPoolFile (BM_BufferPool *const bm, const char *const fileName, int *fileId);
+RC closePoolFile (BM_BufferPool *const bm, const int fileId); // flushes and drops the file's pages
+RC flushPoolFile (BM_BufferPool *const bm, const int fileId);
+RC pinFilePage (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+		const PageNumber pageNum);
+RC pinFilePageHinted (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+		const PageNumber pageNum, const BM_AccessHint hint);
+RC unpinFilePage (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId);
+RC markFileDirty (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId);
+RC unpinFilePageDirty (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+		const int offset, const int length); // length 0: just unpin
+RC forceFilePage (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId);
+RC setFilePagePriority (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+		const BM_PagePriority priority);
+RC pinNewFilePage (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId,
+		PageNumber *pageNum);
+RC discardFileRange (BM_BufferPool *const bm, const int fileId, const PageNumber from, const PageNumber to);
 
 // Statistics Interface
-PageNumber *getFrameContents (BM_BufferPool *const bm);
-bool *getDirtyFlags (BM_BufferPool *const bm);
-int *getFixCounts (BM_BufferPool *const bm);
+PageNumber *getFrameContents (BM_BufferPool *const bm); // legacy: allocates, caller frees
+bool *getDirtyFlags (BM_BufferPool *const bm);          // legacy: allocates, caller frees
+int *getFixCounts (BM_BufferPool *const bm);            // legacy: allocates, caller frees
+// fills up to maxFrames records starting at firstFrame in one pass; *numFilled is 0 past the end.
+// In concurrent mode each call holds the latch only for its own chunk.
+RC getFrameSnapshot (BM_BufferPool *const bm, const int firstFrame, BM_FrameInfo *const out,
+		const int maxFrames, int *numFilled);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+RC getPoolStats (BM_BufferPool *const bm, BM_Stats *const stats); // snapshot, no allocation
+RC resetPoolStats (BM_BufferPool *const bm);
+RC setLatencyTracking (BM_BufferPool *const bm, const bool enabled); // off by default; enabling starts empty
+RC getLatencySummary (BM_BufferPool *const bm, const BM_LatencyOp op, BM_LatencySummary *const out);
+FrameBacking getFrameBacking (BM_BufferPool *const bm);
+int getNumaPartitions (BM_BufferPool *const bm);
+unsigned long long getNumCrossNodeHits (BM_BufferPool *const bm);
+
+// Ghost list: remembers evicted pages to estimate what extra frames would be worth
+RC setGhostListSize (BM_BufferPool *const bm, const int numGhosts); // 0 disables, resets counts
+unsigned long long getGhostHits (BM_BufferPool *const bm, const int extraFrames); // misses extraFrames more frames would have hit
+
+// Access tracing: pin/unpin/markDirty go to per-thread rings, drained to a binary trace file
+// that trace_replay.exe replays against every strategy and pool size
+RC startAccessTrace (BM_BufferPool *const bm, const char *const traceFile, const int ringRecords);
+RC flushAccessTrace (BM_BufferPool *const bm); // drain the rings to the file, one caller at a time
+RC stopAccessTrace (BM_BufferPool *const bm);  // drain and close; shutdownBufferPool also does this
+unsigned long long getNumTraceDropped (BM_BufferPool *const bm); // records lost to full rings
+
+// Miss-ratio curve: SHARDS spatial sampling of pinPage references; a rate of 0.01 keeps the
+// cost on the pin path to one hash and compare for 99% of references. 0 disables. The sample
+// holds at most MRC_MAX_PAGES pages; past that the effective rate drops. Latch-free hits are
+// sampled too.
+RC setMissRatioTracking (BM_BufferPool *const bm, const double samplingRate);
+RC getMissRatioCurve (BM_BufferPool *const bm, BM_MissRatioCurve *const curve);
 
 #endif
@@ -7,45 +7,40 @@
 // local functions
 static void printStrat (BM_BufferPool *const bm);
 
+// frames are read through getFrameSnapshot in chunks of this many records
+#define SNAPSHOT_CHUNK 64
+
 // external functions
 void 
 printPoolContent (BM_BufferPool *const bm)
 {
-	PageNumber *frameContent;
-	bool *dirty;
-	int *fixCount;
-	int i;
-
-	frameContent = getFrameContents(bm);
-	dirty = getDirtyFlags(bm);
-	fixCount = getFixCounts(bm);
+	BM_FrameInfo info[SNAPSHOT_CHUNK];
+	int first, n, i;
 
 	printf("{");
 	printStrat(bm);
 	printf(" %i}: ", bm->numPages);
 
-	for (i = 0; i < bm->numPages; i++)
-		printf("%s[%i%s%i]", ((i == 0) ? "" : ",") , frameContent[i], (dirty[i] ? "x": " "), fixCount[i]);
+	for (first = 0; getFrameSnapshot(bm, first, info, SNAPSHOT_CHUNK, &n) == RC_OK && n > 0; first += n)
+		for (i = 0; i < n; i++)
+			printf("%s[%i%s%i]", ((first + i == 0) ? "" : ",") , info[i].pageNum, (info[i].dirty ? "x": " "), info[i].fixCount);
 	printf("\n");
 }
 
 char *
 sprintPoolContent (BM_BufferPool *const bm)
 {
-	PageNumber *frameContent;
-	bool *dirty;
-	int *fixCount;
-	int i;
+	BM_FrameInfo info[SNAPSHOT_CHUNK];
+	int first, n, i;
 	char *message;
 	int pos = 0;
 
 	message = (char *) malloc(256 + (22 * bm->numPages));
-	frameContent = getFrameContents(bm);
-	dirty = getDirtyFlags(bm);
-	fixCount = getFixCounts(bm);
+	message[0] = '\0';
 
-	for (i = 0; i < bm->numPages; i++)
-		pos += sprintf(message + pos, "%s[%i%s%i]", ((i == 0) ? "" : ",") , frameContent[i], (dirty[i] ? "x": " "), fixCount[i]);
+	for (first = 0; getFrameSnapshot(bm, first, info, SNAPSHOT_CHUNK, &n) == RC_OK && n > 0; first += n)
+		for (i = 0; i < n; i++)
+			pos += sprintf(message + pos, "%s[%i%s%i]", ((first + i == 0) ? "" : ",") , info[i].pageNum, (info[i].dirty ? "x": " "), info[i].fixCount);
 
 	return message;
 }
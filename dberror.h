@@ -15,6 +15,10 @@ typedef int RC;
 #define RC_WRITE_FAILED 3
 #define RC_READ_NON_EXISTING_PAGE 4
 
+#define RC_BM_BUDGET_EXCEEDED 100
+#define RC_BM_INVALID_FILE 101
+#define RC_BM_PAGE_PINNED 102
+
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
 #define RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN 202
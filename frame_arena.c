@@ -0,0 +1,201 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // getcpu
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_arena.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#endif
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+#define HUGE_2MB_SIZE ((size_t)2 << 20)
+#define HUGE_1GB_SIZE ((size_t)1 << 30)
+#define NODE_REFRESH_CALLS 64 // currentNumaNode calls served from the thread's cached node
+
+static size_t roundUp(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+#ifndef _WIN32
+
+static char *mapHuge(size_t len, int log2size) { // explicit huge pages from the hugetlbfs pool
+#ifdef MAP_HUGETLB
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+    flags |= log2size << MAP_HUGE_SHIFT;
+#endif
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+    return (p == MAP_FAILED) ? NULL : (char*)p;
+#else
+    (void)len; (void)log2size;
+    return NULL;
+#endif
+}
+
+static char *mapAligned(size_t len, size_t align) { // regular pages, start aligned to align
+    size_t total = len + align;
+    char *raw = (char*)mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == (char*)MAP_FAILED) return NULL;
+
+    char *start = (char*)roundUp((size_t)raw, align);
+    size_t head = (size_t)(start - raw);
+    size_t tail = total - head - len;
+    if (head > 0) munmap(raw, head);
+    if (tail > 0) munmap(start + len, tail);
+    return start;
+}
+
+static bool thpAvailable(void) { // madvise still succeeds when THP is "never", so ask sysfs
+    FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (f == NULL) return FALSE;
+    char buf[128] = {0};
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    return strstr(buf, "[never]") == NULL;
+}
+
+#endif
+
+RC allocFrameArena(FrameArena *arena, size_t bytes, FrameBacking requested) {
+    if (arena == NULL || bytes == 0) return RC_FILE_HANDLE_NOT_INIT;
+    arena->base = NULL;
+    arena->length = 0;
+    arena->backing = FB_DEFAULT;
+
+#ifdef _WIN32
+    (void)requested;
+    arena->base = (char*)calloc(1, bytes);
+    if (arena->base == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    arena->length = bytes;
+    return RC_OK;
+#else
+    if (requested == FB_HUGE_1GB) {
+        size_t len = roundUp(bytes, HUGE_1GB_SIZE);
+        char *p = mapHuge(len, 30);
+        if (p != NULL) {
+            arena->base = p; arena->length = len; arena->backing = FB_HUGE_1GB;
+            return RC_OK;
+        }
+        requested = FB_HUGE_2MB;
+    }
+    if (requested == FB_HUGE_2MB) {
+        size_t len = roundUp(bytes, HUGE_2MB_SIZE);
+        char *p = mapHuge(len, 21);
+        if (p != NULL) {
+            arena->base = p; arena->length = len; arena->backing = FB_HUGE_2MB;
+            return RC_OK;
+        }
+        requested = FB_THP;
+    }
+    if (requested == FB_THP) {
+        size_t len = roundUp(bytes, HUGE_2MB_SIZE);
+        char *p = mapAligned(len, HUGE_2MB_SIZE);
+        if (p == NULL) return RC_FILE_HANDLE_NOT_INIT;
+        arena->base = p;
+        arena->length = len;
+#ifdef MADV_HUGEPAGE
+        if (thpAvailable() && madvise(p, len, MADV_HUGEPAGE) == 0) arena->backing = FB_THP;
+#endif
+        return RC_OK;
+    }
+
+    size_t len = roundUp(bytes, PAGE_SIZE);
+    char *p = mapAligned(len, PAGE_SIZE);
+    if (p == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    arena->base = p;
+    arena->length = len;
+    return RC_OK;
+#endif
+}
+
+void freeFrameArena(FrameArena *arena) {
+    if (arena == NULL || arena->base == NULL) return;
+#ifdef _WIN32
+    free(arena->base);
+#else
+    munmap(arena->base, arena->length);
+#endif
+    arena->base = NULL;
+    arena->length = 0;
+}
+
+void trimFrameArena(FrameArena *arena, size_t keepBytes) {
+    if (arena == NULL || arena->base == NULL) return;
+    size_t keep = roundUp(keepBytes, PAGE_SIZE);
+    if (keep >= arena->length) return;
+#if !defined(_WIN32) && defined(MADV_DONTNEED)
+    // best effort: huge page mappings refuse a split and simply keep their memory
+    (void)madvise(arena->base + keep, arena->length - keep, MADV_DONTNEED);
+#endif
+}
+
+int onlineNumaNodes(int *nodes, int max) {
+    int count = 0;
+#ifdef __linux__
+    // format is a range list such as "0" or "0-1,4-5"
+    FILE *f = fopen("/sys/devices/system/node/online", "r");
+    if (f != NULL) {
+        int lo, hi;
+        char sep;
+        while (count < max && fscanf(f, "%d", &lo) == 1) {
+            hi = lo;
+            if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+                if (fscanf(f, "%d", &hi) != 1) break;
+                if (fscanf(f, "%c", &sep) != 1) sep = '\n';
+            }
+            for (int n = lo; n <= hi && count < max; n++) nodes[count++] = n;
+            if (sep != ',') break;
+        }
+        fclose(f);
+    }
+#endif
+    if (count == 0 && max > 0) nodes[count++] = 0;
+    return count;
+}
+
+static int lookupNumaNode(void) {
+#if defined(__linux__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 29)
+    // the vDSO getcpu: no kernel entry
+    unsigned int cpu = 0, node = 0;
+    if (getcpu(&cpu, &node) == 0) return (int)node;
+#endif
+#endif
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned int cpuSys = 0, nodeSys = 0;
+    if (syscall(SYS_getcpu, &cpuSys, &nodeSys, NULL) == 0) return (int)nodeSys;
+#endif
+    return -1;
+}
+
+int currentNumaNode(void) {
+    // cached per thread and looked up again every NODE_REFRESH_CALLS calls; a migrated thread
+    // is counted on its old node for a little while
+    static __thread int node = -1;
+    static __thread unsigned int calls = 0;
+    if (calls++ % NODE_REFRESH_CALLS == 0) node = lookupNumaNode();
+    return node;
+}
+
+RC bindFrameArena(FrameArena *arena, int node) {
+    if (arena == NULL || arena->base == NULL || node < 0 || node >= MAX_NUMA_NODES) return RC_FILE_HANDLE_NOT_INIT;
+#if defined(__linux__) && defined(SYS_mbind)
+    // preferred rather than strict binding: a full node spills over instead of failing faults
+    unsigned long mask = 1UL << node;
+    if (syscall(SYS_mbind, arena->base, arena->length, MPOL_PREFERRED, &mask,
+                (unsigned long)(sizeof(mask) * 8), 0) == 0) return RC_OK;
+#endif
+    return RC_WRITE_FAILED;
+}
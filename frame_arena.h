@@ -0,0 +1,27 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stddef.h>
+
+#include "dberror.h"
+#include "buffer_mgr.h"
+
+// One contiguous mapping that holds the data of many frames
+typedef struct FrameArena {
+	char *base;            // start of the mapping
+	size_t length;         // mapped length in bytes
+	FrameBacking backing;  // backing we actually got, may be weaker than requested
+} FrameArena;
+
+// map at least bytes of zeroed memory; falls back 1GB -> 2MB -> THP -> default
+RC allocFrameArena (FrameArena *arena, size_t bytes, FrameBacking requested);
+void freeFrameArena (FrameArena *arena);
+void trimFrameArena (FrameArena *arena, size_t keepBytes); // return memory past keepBytes to the OS
+
+// NUMA placement
+#define MAX_NUMA_NODES 64
+int onlineNumaNodes (int *nodes, int max); // fills online node ids, always reports at least node 0
+int currentNumaNode (void);                 // node of the cpu the caller runs on, -1 if unknown; cached per thread
+RC bindFrameArena (FrameArena *arena, int node); // prefer node for pages not yet touched
+
+#endif
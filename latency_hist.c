@@ -0,0 +1,70 @@
+#include <string.h>
+#include <time.h>
+#include "latency_hist.h"
+
+static int bucketOf(uint64_t v) {
+    if (v < LH_SUB_BUCKETS) return (int)v;
+    int e = 63 - __builtin_clzll(v); // e >= LH_SUB_BITS
+    int sub = (int)((v >> (e - LH_SUB_BITS)) & (LH_SUB_BUCKETS - 1));
+    return (e - LH_SUB_BITS + 1) * LH_SUB_BUCKETS + sub;
+}
+
+static uint64_t bucketUpper(int idx) { // largest value that lands in bucket idx
+    if (idx < LH_SUB_BUCKETS) return (uint64_t)idx;
+    int e = idx / LH_SUB_BUCKETS + LH_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(idx % LH_SUB_BUCKETS);
+    uint64_t width = 1ULL << (e - LH_SUB_BITS);
+    return ((LH_SUB_BUCKETS + sub) << (e - LH_SUB_BITS)) + width - 1;
+}
+
+uint64_t lhNowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void lhReset(LatencyHist *h) {
+    memset(h, 0, sizeof(LatencyHist));
+}
+
+void lhRecord(LatencyHist *h, uint64_t ns) {
+    h->counts[bucketOf(ns)] += 1;
+    h->total += 1;
+    h->sumNs += ns;
+    if (ns > h->maxNs) h->maxNs = ns;
+}
+
+void lhMerge(LatencyHist *dst, const LatencyHist *src) {
+    for (int i = 0; i < LH_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    dst->sumNs += src->sumNs;
+    if (src->maxNs > dst->maxNs) dst->maxNs = src->maxNs;
+}
+
+uint64_t lhCountBelow(const LatencyHist *h, uint64_t v) {
+    uint64_t n = 0;
+    for (int i = 0; i < LH_BUCKETS && bucketUpper(i) < v; i++) {
+        n += h->counts[i];
+    }
+    return n;
+}
+
+uint64_t lhPercentile(const LatencyHist *h, double q) {
+    if (h->total == 0) return 0;
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+
+    uint64_t rank = (uint64_t)(q * (double)h->total + 0.999999);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < LH_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t upper = bucketUpper(i);
+            return (upper < h->maxNs) ? upper : h->maxNs;
+        }
+    }
+    return h->maxNs;
+}
@@ -0,0 +1,26 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+
+// HDR-style histogram: log2 buckets split into 16 linear sub-buckets, so any
+// recorded value is reported within ~6% from 1ns up to the full 64-bit range
+#define LH_SUB_BITS 4
+#define LH_SUB_BUCKETS (1 << LH_SUB_BITS)
+#define LH_BUCKETS ((64 - LH_SUB_BITS + 1) * LH_SUB_BUCKETS)
+
+typedef struct LatencyHist {
+	uint64_t counts[LH_BUCKETS];
+	uint64_t total;
+	uint64_t sumNs;
+	uint64_t maxNs;
+} LatencyHist;
+
+uint64_t lhNowNs (void); // monotonic clock in ns
+void lhReset (LatencyHist *h);
+void lhRecord (LatencyHist *h, uint64_t ns);
+void lhMerge (LatencyHist *dst, const LatencyHist *src);
+uint64_t lhPercentile (const LatencyHist *h, double q); // q in [0,1]; 0 when empty
+uint64_t lhCountBelow (const LatencyHist *h, uint64_t v); // values in buckets entirely below v
+
+#endif
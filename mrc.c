@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mrc.h"
+
+static void fenwickAdd(uint64_t *tree, uint64_t size, uint64_t pos, int64_t delta) { // pos is 1-based
+    for (; pos <= size; pos += pos & (~pos + 1)) tree[pos] += (uint64_t)delta;
+}
+
+static uint64_t fenwickSum(const uint64_t *tree, uint64_t pos) { // marks in [1, pos]
+    uint64_t sum = 0;
+    for (; pos > 0; pos -= pos & (~pos + 1)) sum += tree[pos];
+    return sum;
+}
+
+static MrcEntry *lookup(MrcEntry *table, uint64_t size, uint64_t key, uint64_t hash) {
+    uint64_t i = (hash >> 24) & (size - 1); // low bits went into the sampling decision
+    while (table[i].key != 0 && table[i].key != key) i = (i + 1) & (size - 1);
+    return &table[i];
+}
+
+static int byTime(const void *a, const void *b) {
+    uint64_t x = (*(MrcEntry* const*)a)->time, y = (*(MrcEntry* const*)b)->time;
+    return (x < y) ? -1 : (x > y);
+}
+
+static uint64_t entryHash(const MrcEntry *e) {
+    uint64_t k = e->key - 1;
+    return mrcHash((int)(k >> 32), (int)(uint32_t)k);
+}
+
+// the table is full: drop the threshold by a sixteenth, or to the highest sampled hash if that
+// is lower, so at least one page goes and a full rebuild is not paid on every new page
+static RC lowerThreshold(MrcSampler *s) {
+    uint32_t top = 0;
+    for (uint64_t i = 0; i < s->tableSize; i++) {
+        if (s->table[i].key == 0) continue;
+        uint32_t h = (uint32_t)(entryHash(&s->table[i]) & (MRC_HASH_SPACE - 1));
+        if (h > top) top = h;
+    }
+    uint32_t threshold = atomic_load_explicit(&s->threshold, memory_order_relaxed);
+    threshold -= threshold / 16;
+    if (threshold > top) threshold = top;
+    MrcEntry *table = (MrcEntry*)calloc(s->tableSize, sizeof(MrcEntry));
+    if (table == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    atomic_store_explicit(&s->threshold, threshold, memory_order_relaxed);
+    for (uint64_t i = 0; i < s->tableSize; i++) {
+        MrcEntry *e = &s->table[i];
+        if (e->key == 0) continue;
+        uint64_t hash = entryHash(e);
+        if (mrcSampled(s, hash)) {
+            *lookup(table, s->tableSize, e->key, hash) = *e;
+        } else {
+            fenwickAdd(s->fenwick, s->window, e->time, -1);
+            s->numPages -= 1;
+        }
+    }
+    free(s->table);
+    s->table = table;
+    s->rate = (double)threshold / (double)MRC_HASH_SPACE;
+    return RC_OK;
+}
+
+// renumber last-access times 1..numPages in their current order, so time slots stay bounded
+static RC compact(MrcSampler *s) {
+    MrcEntry **live = (MrcEntry**)malloc(sizeof(MrcEntry*) * (s->numPages > 0 ? s->numPages : 1));
+    if (live == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < s->tableSize; i++) {
+        if (s->table[i].key != 0) live[n++] = &s->table[i];
+    }
+    qsort(live, n, sizeof(MrcEntry*), byTime);
+
+    uint64_t window = 2 * s->tableSize;
+    uint64_t *tree = (uint64_t*)calloc(window + 1, sizeof(uint64_t));
+    if (tree == NULL) {
+        free(live);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        live[i]->time = i + 1;
+        fenwickAdd(tree, window, i + 1, 1);
+    }
+    free(live);
+    free(s->fenwick);
+    s->fenwick = tree;
+    s->window = window;
+    s->now = n;
+    return RC_OK;
+}
+
+RC initMrcSampler(MrcSampler *s, double rate) {
+    if (s == NULL || !(rate > 0.0) || rate > 1.0) return RC_FILE_HANDLE_NOT_INIT;
+    memset(s, 0, sizeof(MrcSampler));
+    uint32_t threshold = (uint32_t)(rate * (double)MRC_HASH_SPACE);
+    if (threshold == 0) threshold = 1;
+    atomic_init(&s->threshold, threshold);
+    s->rate = (double)threshold / (double)MRC_HASH_SPACE;
+    s->tableSize = 2 * MRC_MAX_PAGES; // at most half full
+    s->table = (MrcEntry*)calloc(s->tableSize, sizeof(MrcEntry));
+    s->window = 2 * s->tableSize;
+    s->fenwick = (uint64_t*)calloc(s->window + 1, sizeof(uint64_t));
+    if (s->table == NULL || s->fenwick == NULL) {
+        free(s->table);
+        free(s->fenwick);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    pthread_mutex_init(&s->lock, NULL);
+    return RC_OK;
+}
+
+void freeMrcSampler(MrcSampler *s) {
+    if (s == NULL) return;
+    free(s->table);
+    free(s->fenwick);
+    pthread_mutex_destroy(&s->lock);
+    s->table = NULL;
+    s->fenwick = NULL;
+}
+
+static void recordAccess(MrcSampler *s, int fileId, int pageNum, uint64_t hash) {
+    if (s->now == s->window && compact(s) != RC_OK) return;
+
+    uint64_t key = ((uint64_t)(uint32_t)fileId << 32 | (uint32_t)pageNum) + 1;
+    MrcEntry *e = lookup(s->table, s->tableSize, key, hash);
+    if (e->key == 0 && s->numPages == MRC_MAX_PAGES) {
+        // a new page with no room: the page itself may fall out of the sample
+        if (lowerThreshold(s) != RC_OK || !mrcSampled(s, hash)) return;
+        e = lookup(s->table, s->tableSize, key, hash);
+    }
+    s->samples += 1;
+    s->now += 1;
+
+    if (e->key == 0) {
+        e->key = key;
+        s->numPages += 1;
+        s->coldMisses += 1;
+    } else {
+        // distinct sampled pages touched since the last access, scaled up to the full stream
+        uint64_t d = fenwickSum(s->fenwick, s->now - 1) - fenwickSum(s->fenwick, e->time);
+        lhRecord(&s->distances, (uint64_t)((double)d / s->rate));
+        fenwickAdd(s->fenwick, s->window, e->time, -1);
+    }
+    e->time = s->now;
+    fenwickAdd(s->fenwick, s->window, s->now, 1);
+}
+
+void mrcAccess(MrcSampler *s, int fileId, int pageNum) {
+    uint64_t hash = mrcHash(fileId, pageNum);
+    pthread_mutex_lock(&s->lock);
+    // the threshold may have dropped since the caller looked
+    if (mrcSampled(s, hash)) recordAccess(s, fileId, pageNum, hash);
+    pthread_mutex_unlock(&s->lock);
+}
+
+double mrcHitRatio(MrcSampler *s, int frames) {
+    if (frames <= 0) return 0.0;
+    pthread_mutex_lock(&s->lock);
+    // a reference hits in an LRU pool of n frames when fewer than n other pages came in between
+    double ratio = (s->samples == 0) ? 0.0 : (double)lhCountBelow(&s->distances, (uint64_t)frames) / (double)s->samples;
+    pthread_mutex_unlock(&s->lock);
+    return ratio;
+}
+
+uint64_t mrcSamples(MrcSampler *s) {
+    pthread_mutex_lock(&s->lock);
+    uint64_t n = s->samples;
+    pthread_mutex_unlock(&s->lock);
+    return n;
+}
@@ -0,0 +1,56 @@
+#ifndef MRC_H
+#define MRC_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "dberror.h"
+#include "latency_hist.h"
+
+// SHARDS: pages whose hash falls below a threshold are sampled, and LRU reuse distances
+// are measured on the sample only, then scaled by 1/rate to estimate the full stream.
+// The sample is fixed-size: once MRC_MAX_PAGES pages are tracked, the threshold drops to
+// shed the pages with the highest hashes, so memory stays bounded however many pages pass
+#define MRC_HASH_SPACE (1u << 24)
+#define MRC_MAX_PAGES 8192
+
+typedef struct MrcEntry { // last access of one sampled page
+	uint64_t key;   // (fileId << 32 | pageNum) + 1, 0 marks an empty slot
+	uint64_t time;
+} MrcEntry;
+
+typedef struct MrcSampler {
+	_Atomic uint32_t threshold; // sample when hash < threshold; rate = threshold / MRC_HASH_SPACE
+	double rate;
+	pthread_mutex_t lock;  // guards the rest; taken for sampled references only
+	MrcEntry *table;       // open addressing, 2 * MRC_MAX_PAGES slots
+	uint64_t tableSize;
+	uint64_t numPages;     // sampled pages seen so far
+	uint64_t *fenwick;     // one mark per time slot holding some page's last access
+	uint64_t window;       // time slots in fenwick; compacted when full
+	uint64_t now;
+	LatencyHist distances; // scaled reuse distances, in frames
+	uint64_t coldMisses;   // first touches in the sample
+	uint64_t samples;      // sampled references
+} MrcSampler;
+
+static inline uint64_t mrcHash(int fileId, int pageNum) { // splitmix64 finalizer
+	uint64_t z = ((uint64_t)(uint32_t)fileId << 32 | (uint32_t)pageNum) + 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// the only work done for references outside the sample; needs no lock
+static inline int mrcSampled (MrcSampler *s, uint64_t hash) {
+	return (uint32_t)(hash & (MRC_HASH_SPACE - 1)) < atomic_load_explicit(&s->threshold, memory_order_relaxed);
+}
+
+RC initMrcSampler (MrcSampler *s, double rate); // rate in (0, 1]
+void freeMrcSampler (MrcSampler *s);
+void mrcAccess (MrcSampler *s, int fileId, int pageNum); // call only for sampled references; thread-safe
+double mrcHitRatio (MrcSampler *s, int frames);         // predicted LRU hit ratio at that size
+uint64_t mrcSamples (MrcSampler *s);
+
+#endif
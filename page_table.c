@@ -0,0 +1,346 @@
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+#include "page_table.h"
+
+#define PT_MARK ((uintptr_t)1) // low bit of a next link: the node holding the link is removed
+
+struct PtNode {
+    uint64_t key;
+    int value;
+    _Atomic uintptr_t next;
+    PtNode *retiredNext;       // limbo chain once unlinked
+};
+
+static _Atomic unsigned long long nextTableId = 1;
+
+// the calling thread's record in the table it last used
+static __thread unsigned long long tlsTableId = 0;
+static __thread PtThread *tlsThread = NULL;
+static __thread char tlsToken;
+
+typedef struct PtOwned { // a record the calling thread holds, by the id of its table
+    unsigned long long tableId;
+    PtThread *record;
+} PtOwned;
+
+// released by a key destructor when the thread exits, in the tables still alive then
+static __thread PtOwned *tlsOwned = NULL;
+static __thread int tlsNumOwned = 0;
+static pthread_once_t exitKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t exitKey;
+static pthread_mutex_t liveLock = PTHREAD_MUTEX_INITIALIZER; // guards liveTables and releases
+static PageTable *liveTables = NULL;
+
+static PtNode *nodeOf(uintptr_t link) {
+    return (PtNode*)(link & ~PT_MARK);
+}
+
+static uint64_t keyOf(int fileId, int pageNum) {
+    return (uint64_t)(uint32_t)fileId << 32 | (uint32_t)pageNum;
+}
+
+static _Atomic uintptr_t *bucketOf(PageTable *pt, uint64_t key) { // splitmix64 finalizer
+    uint64_t z = key + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return &pt->buckets[(z ^ (z >> 31)) & pt->mask];
+}
+
+static int numThreadSlots(PageTable *pt) {
+    int n = atomic_load(&pt->numThreads);
+    return (n < PT_MAX_THREADS) ? n : PT_MAX_THREADS;
+}
+
+static void releaseThread(void *unused) {
+    (void)unused;
+    // outside every critical section by now: the records can go to the next thread as they are
+    pthread_mutex_lock(&liveLock);
+    for (int i = 0; i < tlsNumOwned; i++) {
+        for (PageTable *pt = liveTables; pt != NULL; pt = pt->nextLive) {
+            if (pt->id != tlsOwned[i].tableId) continue;
+            atomic_store(&tlsOwned[i].record->owner, NULL);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&liveLock);
+    free(tlsOwned);
+    tlsOwned = NULL;
+    tlsNumOwned = 0;
+    tlsTableId = 0;
+    tlsThread = NULL;
+}
+
+static void makeExitKey(void) {
+    (void)pthread_key_create(&exitKey, releaseThread);
+}
+
+static bool rememberOwned(PageTable *pt, PtThread *t) {
+    // grows by powers of two; a thread rarely uses more than a few tables
+    if ((tlsNumOwned & (tlsNumOwned - 1)) == 0) {
+        PtOwned *grown = (PtOwned*)realloc(tlsOwned, sizeof(PtOwned) * (tlsNumOwned > 0 ? 2 * tlsNumOwned : 1));
+        if (grown == NULL) return FALSE;
+        tlsOwned = grown;
+    }
+    if (tlsNumOwned == 0) {
+        pthread_once(&exitKeyOnce, makeExitKey);
+        if (pthread_setspecific(exitKey, &tlsToken) != 0) return FALSE;
+    }
+    tlsOwned[tlsNumOwned].tableId = pt->id;
+    tlsOwned[tlsNumOwned].record = t;
+    tlsNumOwned++;
+    return TRUE;
+}
+
+static PtThread *threadOf(PageTable *pt) { // register the caller on first use; NULL when out of slots
+    if (tlsTableId == pt->id) return tlsThread;
+    tlsTableId = pt->id;
+
+    // a thread switching between tables keeps its record
+    tlsThread = NULL;
+    int n = numThreadSlots(pt);
+    for (int i = 0; i < n; i++) {
+        PtThread *t = atomic_load_explicit(&pt->threads[i], memory_order_acquire);
+        if (t != NULL && atomic_load(&t->owner) == &tlsToken) {
+            tlsThread = t;
+            return t;
+        }
+    }
+    // then a record an exited thread gave back, then a new one
+    PtThread *t = NULL;
+    for (int i = 0; i < n && t == NULL; i++) {
+        PtThread *given = atomic_load_explicit(&pt->threads[i], memory_order_acquire);
+        const void *none = NULL;
+        if (given != NULL && atomic_compare_exchange_strong(&given->owner, &none, (const void*)&tlsToken)) t = given;
+    }
+    if (t == NULL) {
+        int idx = atomic_fetch_add(&pt->numThreads, 1);
+        if (idx >= PT_MAX_THREADS) return NULL;
+        t = (PtThread*)calloc(1, sizeof(PtThread));
+        if (t == NULL) return NULL;
+        atomic_init(&t->seq, 0);
+        atomic_init(&t->epoch, 0);
+        atomic_init(&t->owner, (const void*)&tlsToken);
+        atomic_store(&pt->threads[idx], t); // ordered before this thread's first entry for ptSynchronize
+    }
+    if (!rememberOwned(pt, t)) {
+        // could not arrange the release at exit: hand the record straight back
+        atomic_store(&t->owner, NULL);
+        return NULL;
+    }
+    tlsThread = t;
+    return t;
+}
+
+static void freeChain(PtNode *n, int viaRetired) {
+    while (n != NULL) {
+        PtNode *next = viaRetired ? n->retiredNext : nodeOf(atomic_load(&n->next));
+        free(n);
+        n = next;
+    }
+}
+
+static void tryAdvance(PageTable *pt) {
+    // the epoch moves on once every thread inside a critical section has seen the current one
+    uint64_t e = atomic_load(&pt->epoch);
+    int n = numThreadSlots(pt);
+    for (int i = 0; i < n; i++) {
+        PtThread *t = atomic_load_explicit(&pt->threads[i], memory_order_acquire);
+        if (t == NULL) continue; // registered but not published: not inside yet
+        if ((atomic_load(&t->seq) & 1) && atomic_load(&t->epoch) != e) return;
+    }
+    if (!atomic_compare_exchange_strong(&pt->epoch, &e, e + 1)) return;
+    // nodes retired two epochs back are out of every walk still running
+    freeChain(atomic_exchange(&pt->limbo[(e + 2) % 3], NULL), 1);
+}
+
+static void retire(PageTable *pt, PtNode *n, bool inside) {
+    if (!inside) {
+        // no thread slot to label the node with: wait out every reader instead
+        ptSynchronize(pt);
+        free(n);
+        return;
+    }
+    // labelled with the epoch after the unlink, so any walker that can still reach it is no newer
+    _Atomic(PtNode*) *list = &pt->limbo[atomic_load(&pt->epoch) % 3];
+    PtNode *top = atomic_load(list);
+    do {
+        n->retiredNext = top;
+    } while (!atomic_compare_exchange_weak(list, &top, n));
+}
+
+static void unlinkMarked(PageTable *pt, _Atomic uintptr_t *head, bool inside) {
+    // a failed CAS means the link changed under us; start over from the chain head
+retry:;
+    _Atomic uintptr_t *prev = head;
+    uintptr_t cur = atomic_load(prev);
+    while (nodeOf(cur) != NULL) {
+        PtNode *n = nodeOf(cur);
+        uintptr_t next = atomic_load(&n->next);
+        if (next & PT_MARK) {
+            uintptr_t expect = cur;
+            if (!atomic_compare_exchange_strong(prev, &expect, next & ~PT_MARK)) goto retry;
+            retire(pt, n, inside);
+            cur = next & ~PT_MARK;
+            continue;
+        }
+        prev = &n->next;
+        cur = next;
+    }
+}
+
+RC initPageTable(PageTable *pt, int expectedKeys) {
+    if (pt == NULL || expectedKeys < 0) return RC_FILE_HANDLE_NOT_INIT;
+    uint64_t size = 16;
+    while (size < 2 * (uint64_t)expectedKeys) size <<= 1;
+    pt->buckets = (_Atomic uintptr_t*)malloc(sizeof(_Atomic uintptr_t) * size);
+    if (pt->buckets == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    for (uint64_t b = 0; b < size; b++) atomic_init(&pt->buckets[b], 0);
+    pt->mask = size - 1;
+    pt->id = atomic_fetch_add(&nextTableId, 1);
+    atomic_init(&pt->epoch, 0);
+    for (int l = 0; l < 3; l++) atomic_init(&pt->limbo[l], NULL);
+    atomic_init(&pt->numThreads, 0);
+    for (int i = 0; i < PT_MAX_THREADS; i++) atomic_init(&pt->threads[i], NULL);
+    pthread_mutex_lock(&liveLock);
+    pt->nextLive = liveTables;
+    liveTables = pt;
+    pthread_mutex_unlock(&liveLock);
+    return RC_OK;
+}
+
+void freePageTable(PageTable *pt) {
+    if (pt == NULL || pt->buckets == NULL) return;
+    // off the live list first, so no exiting thread touches the records freed below
+    pthread_mutex_lock(&liveLock);
+    PageTable **link = &liveTables;
+    while (*link != NULL && *link != pt) link = &(*link)->nextLive;
+    if (*link != NULL) *link = pt->nextLive;
+    pthread_mutex_unlock(&liveLock);
+    for (uint64_t b = 0; b <= pt->mask; b++) freeChain(nodeOf(atomic_load(&pt->buckets[b])), 0);
+    for (int l = 0; l < 3; l++) freeChain(atomic_load(&pt->limbo[l]), 1);
+    for (int i = 0; i < PT_MAX_THREADS; i++) free(atomic_load(&pt->threads[i]));
+    free(pt->buckets);
+    pt->buckets = NULL;
+}
+
+RC ptRehash(PageTable *pt, int expectedKeys) {
+    if (pt == NULL || pt->buckets == NULL || expectedKeys < 0) return RC_FILE_HANDLE_NOT_INIT;
+    uint64_t size = 16;
+    while (size < 2 * (uint64_t)expectedKeys) size <<= 1;
+    if (size <= pt->mask + 1) return RC_OK;
+    _Atomic uintptr_t *buckets = (_Atomic uintptr_t*)malloc(sizeof(_Atomic uintptr_t) * size);
+    if (buckets == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    for (uint64_t b = 0; b < size; b++) atomic_init(&buckets[b], 0);
+
+    // nobody walks the chains, so the nodes relink in place; a removed node still linked is simply freed
+    _Atomic uintptr_t *old = pt->buckets;
+    uint64_t oldSize = pt->mask + 1;
+    pt->buckets = buckets;
+    pt->mask = size - 1;
+    for (uint64_t b = 0; b < oldSize; b++) {
+        PtNode *n = nodeOf(atomic_load(&old[b]));
+        while (n != NULL) {
+            uintptr_t next = atomic_load(&n->next);
+            if (next & PT_MARK) {
+                free(n);
+            } else {
+                _Atomic uintptr_t *head = bucketOf(pt, n->key);
+                atomic_store(&n->next, atomic_load(head));
+                atomic_store(head, (uintptr_t)n);
+            }
+            n = nodeOf(next);
+        }
+    }
+    free(old);
+    return RC_OK;
+}
+
+bool ptEnter(PageTable *pt) {
+    PtThread *t = threadOf(pt);
+    if (t == NULL) return FALSE;
+    if (t->depth++ > 0) return TRUE;
+    // announce first, then settle on an epoch that was current while announced
+    atomic_fetch_add(&t->seq, 1);
+    uint64_t e = atomic_load(&pt->epoch);
+    for (;;) {
+        atomic_store(&t->epoch, e);
+        uint64_t now = atomic_load(&pt->epoch);
+        if (now == e) break;
+        e = now;
+    }
+    return TRUE;
+}
+
+void ptExit(PageTable *pt) {
+    PtThread *t = threadOf(pt);
+    if (t == NULL || --t->depth > 0) return;
+    atomic_fetch_add_explicit(&t->seq, 1, memory_order_release);
+}
+
+void ptSynchronize(PageTable *pt) {
+    PtThread *self = (tlsTableId == pt->id) ? tlsThread : NULL;
+    atomic_thread_fence(memory_order_seq_cst);
+    int n = numThreadSlots(pt);
+    for (int i = 0; i < n; i++) {
+        PtThread *t = atomic_load(&pt->threads[i]); // NULL: published later, so it enters after our caller's change
+        if (t == NULL || t == self) continue;
+        uint64_t s = atomic_load(&t->seq);
+        if (!(s & 1)) continue;
+        while (atomic_load(&t->seq) == s) sched_yield();
+    }
+}
+
+int ptLookup(PageTable *pt, int fileId, int pageNum) {
+    // bounded walk: inserts go in at the head, behind us
+    uint64_t key = keyOf(fileId, pageNum);
+    uintptr_t link = atomic_load(bucketOf(pt, key));
+    while (nodeOf(link) != NULL) {
+        PtNode *n = nodeOf(link);
+        uintptr_t next = atomic_load(&n->next);
+        if (n->key == key && !(next & PT_MARK)) return n->value;
+        link = next;
+    }
+    return -1;
+}
+
+RC ptInsert(PageTable *pt, int fileId, int pageNum, int value) {
+    PtNode *n = (PtNode*)malloc(sizeof(PtNode));
+    if (n == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    n->key = keyOf(fileId, pageNum);
+    n->value = value;
+    n->retiredNext = NULL;
+    _Atomic uintptr_t *head = bucketOf(pt, n->key);
+    uintptr_t first = atomic_load(head);
+    do {
+        atomic_store_explicit(&n->next, first, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak(head, &first, (uintptr_t)n));
+    return RC_OK;
+}
+
+bool ptRemove(PageTable *pt, int fileId, int pageNum) {
+    uint64_t key = keyOf(fileId, pageNum);
+    _Atomic uintptr_t *head = bucketOf(pt, key);
+    bool inside = ptEnter(pt);
+
+    // marking the node's own next link is the removal; unlinking it is cleanup anyone may do
+    bool removed = FALSE;
+    uintptr_t link = atomic_load(head);
+    while (nodeOf(link) != NULL && !removed) {
+        PtNode *n = nodeOf(link);
+        uintptr_t next = atomic_load(&n->next);
+        if (n->key == key && !(next & PT_MARK)) {
+            while (!(next & PT_MARK) && !removed) {
+                removed = atomic_compare_exchange_weak(&n->next, &next, next | PT_MARK);
+            }
+            if (!removed) break; // a concurrent remove won
+        }
+        link = next;
+    }
+    if (removed) unlinkMarked(pt, head, inside);
+    if (inside) {
+        tryAdvance(pt);
+        ptExit(pt);
+    }
+    return removed;
+}
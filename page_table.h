@@ -0,0 +1,58 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "dberror.h"
+#include "dt.h"
+
+// Lock-free hash from (fileId, pageNum) to a frame index. Each bucket is a chain whose links
+// change only by CAS; a removed node has the low bit of its next link set before it is unlinked.
+// Lookups take a bounded walk and never wait. Unlinked nodes are freed by epoch-based
+// reclamation, once every thread that could still be walking over them has left its
+// critical section (ptEnter/ptExit). A thread takes a slot in a table on first use and gives
+// it back when it exits, so PT_MAX_THREADS bounds the threads using a table at once, not ever.
+// The bucket count is fixed between ptRehash calls; chains just grow longer past it.
+#define PT_MAX_THREADS 256
+
+typedef struct PtNode PtNode;
+
+typedef struct PtThread { // one registered thread; only its owner writes seq and epoch
+	_Atomic uint64_t seq;    // odd while inside a critical section
+	_Atomic uint64_t epoch;  // global epoch seen on entry
+	_Atomic(const void*) owner; // address of the owner's thread-local token, NULL once it exited
+	int depth;               // nesting of ptEnter calls
+	char pad[32];            // one record per cache line
+} PtThread;
+
+typedef struct PageTable {
+	_Atomic uintptr_t *buckets;                // chain heads, never marked
+	uint64_t mask;                             // bucket count - 1
+	unsigned long long id;                     // tells this table from an older one at the same address
+	_Atomic uint64_t epoch;
+	_Atomic(PtNode*) limbo[3];                 // unlinked nodes by retire epoch mod 3
+	_Atomic int numThreads;
+	_Atomic(PtThread*) threads[PT_MAX_THREADS];
+	struct PageTable *nextLive;                // list of live tables, for threads releasing slots
+} PageTable;
+
+RC initPageTable (PageTable *pt, int expectedKeys); // buckets: a power of two >= 2 * expectedKeys
+void freePageTable (PageTable *pt);                 // no thread may be using the table
+// rebucket for expectedKeys, never shrinking; no thread may be inside the table or changing it
+RC ptRehash (PageTable *pt, int expectedKeys);
+
+// critical sections nest; FALSE when all thread slots are taken, then the caller must not
+// walk the table unless it excludes removals some other way
+bool ptEnter (PageTable *pt);
+void ptExit (PageTable *pt);
+// returns once every critical section open at the call has ended
+void ptSynchronize (PageTable *pt);
+
+// -1 when absent. Inside a critical section, or with removals excluded by the caller
+int ptLookup (PageTable *pt, int fileId, int pageNum);
+// the key must not be present; inserts and removals may run from many threads at once
+RC ptInsert (PageTable *pt, int fileId, int pageNum, int value);
+bool ptRemove (PageTable *pt, int fileId, int pageNum);
+
+#endif
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "pool_governor.h"
+
+static int committedFrames(BM_PoolGovernor *const gov) { // frames the governed pools hold right now
+    int sum = 0;
+    for (int i = 0; i < gov->numPools; i++) {
+        sum += gov->pools[i]->numPages;
+    }
+    return sum;
+}
+
+static RC growPool(BM_PoolGovernor *const gov, int i, int frames) {
+    BM_BufferPool *bm = gov->pools[i];
+    RC rc = resizeBufferPool(bm, bm->numPages + frames);
+    if (rc != RC_OK) return rc;
+    // evictions from before the grow are now covered by the new frames; start a fresh ghost list
+    gov->lastGhostHits[i] = 0ULL;
+    return setGhostListSize(bm, (bm->numPages > gov->step) ? bm->numPages : gov->step);
+}
+
+RC initPoolGovernor(BM_PoolGovernor *const gov, const int totalFrames, const int step) {
+    if (gov == NULL || totalFrames <= 0 || step <= 0) return RC_FILE_HANDLE_NOT_INIT;
+    gov->totalFrames = totalFrames;
+    gov->step = step;
+    gov->minFrames = 1;
+    gov->numPools = 0;
+    gov->pools = NULL;
+    gov->lastGhostHits = NULL;
+    return RC_OK;
+}
+
+RC shutdownPoolGovernor(BM_PoolGovernor *const gov) {
+    if (gov == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    // the pools stay open; they belong to the caller
+    for (int i = 0; i < gov->numPools; i++) {
+        (void)setGhostListSize(gov->pools[i], 0);
+    }
+    free(gov->pools);
+    free(gov->lastGhostHits);
+    gov->pools = NULL;
+    gov->lastGhostHits = NULL;
+    gov->numPools = 0;
+    return RC_OK;
+}
+
+RC addGovernedPool(BM_PoolGovernor *const gov, BM_BufferPool *const bm) {
+    if (gov == NULL || bm == NULL || bm->mgmtData == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (committedFrames(gov) + bm->numPages > gov->totalFrames) return RC_BM_BUDGET_EXCEEDED;
+
+    BM_BufferPool **pools = (BM_BufferPool**)realloc(gov->pools, sizeof(BM_BufferPool*) * (gov->numPools + 1));
+    if (pools == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    gov->pools = pools;
+    unsigned long long *last = (unsigned long long*)realloc(gov->lastGhostHits, sizeof(unsigned long long) * (gov->numPools + 1));
+    if (last == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    gov->lastGhostHits = last;
+
+    // the ghost list has to reach at least one step past the pool to price a step of frames
+    int ghosts = (bm->numPages > gov->step) ? bm->numPages : gov->step;
+    RC rc = setGhostListSize(bm, ghosts);
+    if (rc != RC_OK) return rc;
+
+    gov->pools[gov->numPools] = bm;
+    gov->lastGhostHits[gov->numPools] = 0ULL;
+    gov->numPools += 1;
+    return RC_OK;
+}
+
+RC removeGovernedPool(BM_PoolGovernor *const gov, BM_BufferPool *const bm) {
+    if (gov == NULL || bm == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    for (int i = 0; i < gov->numPools; i++) {
+        if (gov->pools[i] != bm) continue;
+        gov->pools[i] = gov->pools[gov->numPools - 1];
+        gov->lastGhostHits[i] = gov->lastGhostHits[gov->numPools - 1];
+        gov->numPools -= 1;
+        if (bm->mgmtData != NULL) (void)setGhostListSize(bm, 0);
+        return RC_OK;
+    }
+    return RC_FILE_HANDLE_NOT_INIT;
+}
+
+int getFreeFrameBudget(BM_PoolGovernor *const gov) {
+    if (gov == NULL) return 0;
+    int spare = gov->totalFrames - committedFrames(gov);
+    return (spare > 0) ? spare : 0;
+}
+
+RC rebalancePools(BM_PoolGovernor *const gov) {
+    if (gov == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    if (gov->numPools == 0) return RC_OK;
+
+    // marginal utility of one more step of frames = ghost hits within step, since the last call
+    int best = -1, worst = -1;
+    unsigned long long bestGain = 0ULL, worstGain = ULLONG_MAX;
+    for (int i = 0; i < gov->numPools; i++) {
+        BM_BufferPool *bm = gov->pools[i];
+        unsigned long long now = getGhostHits(bm, gov->step);
+        unsigned long long gain = (now >= gov->lastGhostHits[i]) ? now - gov->lastGhostHits[i] : now;
+        gov->lastGhostHits[i] = now;
+
+        if (best < 0 || gain > bestGain) {
+            best = i;
+            bestGain = gain;
+        }
+        if (bm->numPages - gov->step >= gov->minFrames && gain < worstGain) {
+            worst = i;
+            worstGain = gain;
+        }
+    }
+    if (bestGain == 0ULL) return RC_OK; // nobody would turn more memory into hits
+
+    int spare = getFreeFrameBudget(gov);
+    if (spare > 0) {
+        return growPool(gov, best, (spare < gov->step) ? spare : gov->step);
+    }
+
+    // hysteresis: only move when the receiver clearly values the frames more, to avoid ping-pong
+    if (worst < 0 || worst == best || bestGain <= worstGain + worstGain / 4) return RC_OK;
+
+    BM_BufferPool *donor = gov->pools[worst];
+    int before = donor->numPages;
+    RC rc = resizeBufferPool(donor, before - gov->step);
+    if (rc != RC_OK) return rc;
+
+    // a pinned frame can delay part of the shrink; only hand over what is already released
+    int freed = before - donor->numPages;
+    if (freed <= 0) return RC_OK;
+    return growPool(gov, best, freed);
+}
@@ -0,0 +1,29 @@
+#ifndef POOL_GOVERNOR_H
+#define POOL_GOVERNOR_H
+
+#include "dberror.h"
+#include "buffer_mgr.h"
+
+// Shares one global frame budget between many buffer pools. Frames move from the pool whose
+// ghost list says extra memory is worth least to the one where it is worth most.
+typedef struct BM_PoolGovernor {
+	int totalFrames;    // budget; the sum of all governed pools' numPages never exceeds it
+	int step;           // frames moved per rebalance
+	int minFrames;      // no pool is shrunk below this
+	int numPools;
+	BM_BufferPool **pools;
+	unsigned long long *lastGhostHits; // per pool, reading taken at the previous rebalance
+} BM_PoolGovernor;
+
+RC initPoolGovernor (BM_PoolGovernor *const gov, const int totalFrames, const int step);
+RC shutdownPoolGovernor (BM_PoolGovernor *const gov);
+
+// the pool must already be initialized; its frames are charged to the budget
+RC addGovernedPool (BM_PoolGovernor *const gov, BM_BufferPool *const bm);
+RC removeGovernedPool (BM_PoolGovernor *const gov, BM_BufferPool *const bm);
+
+// one decision: hand out spare budget, or move step frames between two pools
+RC rebalancePools (BM_PoolGovernor *const gov);
+int getFreeFrameBudget (BM_PoolGovernor *const gov);
+
+#endif
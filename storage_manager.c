@@ -1,15 +1,23 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // O_DIRECT
+#endif
 #include <fcntl.h>    
 #include <unistd.h>     
 #include <sys/stat.h>  
+#include <sys/uio.h>
 #include <stdlib.h>    
 #include <string.h>     
+#include <pthread.h>
 #include "storage_mgr.h"
+#include "latency_hist.h"
 #include "dberror.h"
 
 #ifndef PAGE_SIZE
 #define PAGE_SIZE 4096
 #endif
 
+#define READV_MAX_PAGES 64 // iovecs per preadv call, well under IOV_MAX
+
 // // Struct used to store the fHandle->mgmtInfo; holds the OS file descriptor (int)
 typedef struct InternalFileHandle {
     int fd;
@@ -23,6 +31,19 @@ typedef struct OpenNode {
 
 static OpenNode *g_open_files = NULL;
 
+// readBlock/writeBlock latency, indexed by SM_LAT_READ/SM_LAT_WRITE; NULL while tracking is off
+static LatencyHist *g_latency = NULL;
+static pthread_mutex_t g_latencyLock = PTHREAD_MUTEX_INITIALIZER; // writeBlocks records from many threads
+
+static void recordLatency(int op, uint64_t t0, int pages) { // one entry per page, at the call's mean
+    pthread_mutex_lock(&g_latencyLock);
+    if (g_latency != NULL) {
+        uint64_t each = (lhNowNs() - t0) / (uint64_t)pages;
+        for (int i = 0; i < pages; i++) lhRecord(&g_latency[op], each);
+    }
+    pthread_mutex_unlock(&g_latencyLock);
+}
+
 static void addOpenFile(const char *name, int fd) {//Function to append the Linked list for opened files
     OpenNode *n = (OpenNode*)malloc(sizeof(OpenNode));
     if (n == NULL) return;
@@ -92,20 +113,17 @@ static RC updatePageCount(int fd, SM_FileHandle *fh) {
     return RC_OK;
 }
 
-static RC write_zero_page_fd(int fd) {
-    char *zeros = (char*)malloc(PAGE_SIZE);
-    if (zeros == NULL) return RC_WRITE_FAILED;
-    memset(zeros, 0, PAGE_SIZE);
+// page-aligned so it can also be written to files opened with O_DIRECT
+static char g_zero_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
 
+static RC write_zero_page_fd(int fd) {
     // loop until PAGE_SIZE bytes written
     ssize_t total = 0;
     while (total < PAGE_SIZE) {
-        ssize_t w = write(fd, zeros + total, PAGE_SIZE - total);
-        if (w <= 0) { free(zeros); return RC_WRITE_FAILED; }
+        ssize_t w = write(fd, g_zero_page + total, PAGE_SIZE - total);
+        if (w <= 0) return RC_WRITE_FAILED;
         total += w;
     }
-
-    free(zeros);
     return RC_OK;
 }
 
@@ -128,10 +146,10 @@ RC createPageFile(char *fileName) {
     return rc;
 }
 
-RC openPageFile(char *fileName, SM_FileHandle *fHandle) {
+static RC openWithFlags(char *fileName, SM_FileHandle *fHandle, int extraFlags) {
     if (fHandle == NULL || fileName == NULL) return RC_FILE_HANDLE_NOT_INIT;
 
-    int fd = open(fileName, O_RDWR
+    int fd = open(fileName, O_RDWR | extraFlags
 #ifdef _WIN32
         | O_BINARY
 #endif
@@ -159,6 +177,19 @@ RC openPageFile(char *fileName, SM_FileHandle *fHandle) {
     return RC_OK;
 }
 
+RC openPageFile(char *fileName, SM_FileHandle *fHandle) {
+    return openWithFlags(fileName, fHandle, 0);
+}
+
+RC openPageFileDirect(char *fileName, SM_FileHandle *fHandle) {
+#ifdef O_DIRECT
+    return openWithFlags(fileName, fHandle, O_DIRECT);
+#else
+    (void)fileName; (void)fHandle;
+    return RC_FILE_NOT_FOUND;
+#endif
+}
+
 RC closePageFile(SM_FileHandle *fHandle) {
     if (fHandle == NULL || fHandle->mgmtInfo == NULL) return RC_FILE_HANDLE_NOT_INIT;
     int fd = get_fd(fHandle);
@@ -186,6 +217,7 @@ RC destroyPageFile(char *fileName) {
 RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
     if (fHandle == NULL || fHandle->mgmtInfo == NULL || memPage == NULL) return RC_FILE_HANDLE_NOT_INIT;
     if (pageNum < 0 || pageNum >= fHandle->totalNumPages) return RC_READ_NON_EXISTING_PAGE;
+    uint64_t t0 = (g_latency != NULL) ? lhNowNs() : 0;
 
     int fd = get_fd(fHandle);
     off_t off = page_offset(pageNum);
@@ -202,6 +234,44 @@ RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
     }
 
     fHandle->curPagePos = pageNum;
+    if (g_latency != NULL) recordLatency(SM_LAT_READ, t0, 1);
+    return RC_OK;
+}
+
+RC readBlocks(int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || memPages == NULL || numPages <= 0) return RC_FILE_HANDLE_NOT_INIT;
+    if (firstPage < 0 || firstPage + numPages > fHandle->totalNumPages) return RC_READ_NON_EXISTING_PAGE;
+    uint64_t t0 = (g_latency != NULL) ? lhNowNs() : 0;
+    int fd = get_fd(fHandle);
+
+    for (int base = 0; base < numPages; base += READV_MAX_PAGES) {
+        int n = (numPages - base < READV_MAX_PAGES) ? numPages - base : READV_MAX_PAGES;
+        struct iovec iov[READV_MAX_PAGES];
+        for (int i = 0; i < n; i++) {
+            iov[i].iov_base = memPages[base + i];
+            iov[i].iov_len = PAGE_SIZE;
+        }
+        off_t off = page_offset(firstPage + base);
+        size_t want = (size_t)n * PAGE_SIZE;
+        ssize_t got = preadv(fd, iov, n, off);
+        if (got < 0) return RC_READ_NON_EXISTING_PAGE;
+
+        // finish a short read page by page; past the end of file reads as zeros
+        size_t done = (size_t)got;
+        while (done < want) {
+            int pg = (int)(done / PAGE_SIZE);
+            size_t in = done % PAGE_SIZE;
+            ssize_t r = pread(fd, memPages[base + pg] + in, PAGE_SIZE - in, off + (off_t)done);
+            if (r < 0) return RC_READ_NON_EXISTING_PAGE;
+            if (r == 0) {
+                memset(memPages[base + pg] + in, 0, PAGE_SIZE - in);
+                for (int i = pg + 1; i < n; i++) memset(memPages[base + i], 0, PAGE_SIZE);
+                break;
+            }
+            done += (size_t)r;
+        }
+    }
+    if (g_latency != NULL) recordLatency(SM_LAT_READ, t0, numPages);
     return RC_OK;
 }
 
@@ -235,12 +305,13 @@ RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
 RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
     if (fHandle == NULL || fHandle->mgmtInfo == NULL || memPage == NULL) return RC_FILE_HANDLE_NOT_INIT;
     if (pageNum < 0) return RC_WRITE_FAILED;
+    uint64_t t0 = (g_latency != NULL) ? lhNowNs() : 0;
 
     int fd = get_fd(fHandle);
 
-    // If we writing beyond current capacity, grow first
-    if (fHandle->totalNumPages <= pageNum) {
-        RC rc = ensureCapacity(pageNum + 1, fHandle);
+    // writing past the end: zero-fill any gap, the write itself extends the file
+    if (fHandle->totalNumPages < pageNum) {
+        RC rc = ensureCapacity(pageNum, fHandle);
         if (rc != RC_OK) return rc;
     }
 
@@ -253,10 +324,42 @@ RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
     }
 
     fHandle->curPagePos = pageNum;
-    (void)updatePageCount(fd, fHandle);
     if (fHandle->totalNumPages <= pageNum)
         fHandle->totalNumPages = pageNum + 1;
 
+    if (g_latency != NULL) recordLatency(SM_LAT_WRITE, t0, 1);
+    return RC_OK;
+}
+
+RC writeBlocks(int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || memPages == NULL || numPages <= 0) return RC_FILE_HANDLE_NOT_INIT;
+    if (firstPage < 0 || firstPage + numPages > fHandle->totalNumPages) return RC_WRITE_FAILED;
+    uint64_t t0 = (g_latency != NULL) ? lhNowNs() : 0;
+    int fd = get_fd(fHandle);
+
+    for (int base = 0; base < numPages; base += READV_MAX_PAGES) {
+        int n = (numPages - base < READV_MAX_PAGES) ? numPages - base : READV_MAX_PAGES;
+        struct iovec iov[READV_MAX_PAGES];
+        for (int i = 0; i < n; i++) {
+            iov[i].iov_base = memPages[base + i];
+            iov[i].iov_len = PAGE_SIZE;
+        }
+        off_t off = page_offset(firstPage + base);
+        size_t want = (size_t)n * PAGE_SIZE;
+        ssize_t put = pwritev(fd, iov, n, off);
+        if (put < 0) return RC_WRITE_FAILED;
+
+        // finish a short write page by page
+        size_t done = (size_t)put;
+        while (done < want) {
+            int pg = (int)(done / PAGE_SIZE);
+            size_t in = done % PAGE_SIZE;
+            ssize_t w = pwrite(fd, memPages[base + pg] + in, PAGE_SIZE - in, off + (off_t)done);
+            if (w <= 0) return RC_WRITE_FAILED;
+            done += (size_t)w;
+        }
+    }
+    if (g_latency != NULL) recordLatency(SM_LAT_WRITE, t0, numPages);
     return RC_OK;
 }
 
@@ -291,3 +394,25 @@ RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle) {
     }
     return RC_OK;
 }
+
+// Latency tracking
+
+void setStorageLatencyTracking(int enabled) {
+    pthread_mutex_lock(&g_latencyLock);
+    if (!enabled) {
+        free(g_latency);
+        g_latency = NULL;
+    } else if (g_latency == NULL) {
+        g_latency = (LatencyHist*)calloc(SM_LAT_NUM_OPS, sizeof(LatencyHist));
+    }
+    pthread_mutex_unlock(&g_latencyLock);
+}
+
+RC getStorageLatencyHistogram(int op, LatencyHist *hist) {
+    if (hist == NULL || op < 0 || op >= SM_LAT_NUM_OPS) return RC_FILE_HANDLE_NOT_INIT;
+    pthread_mutex_lock(&g_latencyLock);
+    if (g_latency == NULL) lhReset(hist);
+    else *hist = g_latency[op];
+    pthread_mutex_unlock(&g_latencyLock);
+    return RC_OK;
+}
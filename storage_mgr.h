@@ -2,6 +2,7 @@
 #define STORAGE_MGR_H
 
 #include "dberror.h"
+#include "latency_hist.h"
 
 /************************************************************
  *                    handle data structures                *
@@ -22,11 +23,15 @@ typedef char* SM_PageHandle;
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+/* bypasses the page cache; page buffers must be PAGE_SIZE aligned. RC_FILE_NOT_FOUND when unsupported */
+extern RC openPageFileDirect (char *fileName, SM_FileHandle *fHandle);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
 /* reading blocks from disc */
 extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+/* numPages consecutive pages in one vectored read; positional, so curPagePos is left alone */
+extern RC readBlocks (int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern int getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
@@ -36,8 +41,18 @@ extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+/* numPages consecutive existing pages in one vectored write; positional, so several threads may
+   write through one handle at once. The file never grows: pages past the end fail */
+extern RC writeBlocks (int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
 
+/* latency of readBlock/writeBlock across all files, off by default */
+#define SM_LAT_READ 0
+#define SM_LAT_WRITE 1
+#define SM_LAT_NUM_OPS 2
+extern void setStorageLatencyTracking (int enabled);
+extern RC getStorageLatencyHistogram (int op, LatencyHist *hist);
+
 #endif
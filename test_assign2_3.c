@@ -0,0 +1,1961 @@
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "pool_governor.h"
+#include "access_trace.h"
+#include "workload.h"
+#include "page_table.h"
+#include "mrc.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// var to store the current test's name
+char *testName;
+
+// check whether two the content of a buffer pool is the same as an expected content
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)                    \
+do {                                    \
+char *real;                                \
+char *_exp = (char *) (expected);                                   \
+real = sprintPoolContent(bm);                    \
+if (strcmp((_exp),real) != 0)                    \
+{                                    \
+printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+free(real);                            \
+exit(1);                            \
+}                                    \
+printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+free(real);                                \
+} while(0)
+
+// test and helper methods
+static void testFrameBacking (void);
+static void testNumaPartitions (void);
+static void testResize (void);
+static void testGovernor (void);
+static void testMultiFile (void);
+static void testPoolStats (void);
+static void testLatencyHistograms (void);
+static void testFrameSnapshot (void);
+static void testAccessTrace (void);
+static void testMissRatioCurve (void);
+static void testWorkloads (void);
+static void testConcurrentPool (void);
+static void testWarmup (void);
+static void testPageHandles (void);
+static void testBatchPins (void);
+static void testNewPages (void);
+static void testUnpinDirty (void);
+static void testAccessHints (void);
+static void testPagePriority (void);
+static void testDiscard (void);
+static void testPageTable (void);
+static void testLatchFreePins (void);
+static void testSwizzling (void);
+static void testParallelFlush (void);
+static int residentPages (BM_BufferPool *bm, PageNumber *pages, int max);
+
+// main method
+int
+main (void)
+{
+    initStorageManager();
+    testName = "";
+
+    testFrameBacking();
+    testNumaPartitions();
+    testResize();
+    testGovernor();
+    testMultiFile();
+    testPoolStats();
+    testLatencyHistograms();
+    testFrameSnapshot();
+    testAccessTrace();
+    testMissRatioCurve();
+    testWorkloads();
+    testConcurrentPool();
+    testWarmup();
+    testPageHandles();
+    testBatchPins();
+    testNewPages();
+    testUnpinDirty();
+    testAccessHints();
+    testPagePriority();
+    testDiscard();
+    testPageTable();
+    testLatchFreePins();
+    testSwizzling();
+    testParallelFlush();
+    return 0;
+}
+
+// every requested backing must come up (possibly downgraded) and hold page-aligned frames
+void
+testFrameBacking (void)
+{
+    const FrameBacking requests[] = { FB_DEFAULT, FB_THP, FB_HUGE_2MB, FB_HUGE_1GB };
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions opts;
+    int r, i;
+    testName = "Huge page frame backing";
+
+    CHECK(createPageFile("testbuffer.bin"));
+
+    for (r = 0; r < 4; r++)
+    {
+        memset(&opts, 0, sizeof(opts));
+        opts.backing = requests[r];
+        CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &opts));
+        ASSERT_TRUE(getFrameBacking(bm) <= requests[r], "backing never exceeds the request");
+
+        for (i = 0; i < 12; i++)
+        {
+            CHECK(pinPage(bm, h, i));
+            ASSERT_TRUE(((uintptr_t) h->data % PAGE_SIZE) == 0, "frame data is page-aligned");
+            sprintf(h->data, "%s-%i-%i", "Page", h->pageNum, r);
+            CHECK(markDirty(bm, h));
+            CHECK(unpinPage(bm, h));
+        }
+        CHECK(shutdownBufferPool(bm));
+
+        CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_FIFO, NULL, &opts));
+        for (i = 0; i < 12; i++)
+        {
+            char expected[64];
+            sprintf(expected, "%s-%i-%i", "Page", i, r);
+            CHECK(pinPage(bm, h, i));
+            ASSERT_EQUALS_STRING(expected, h->data, "reading back dummy page content");
+            CHECK(unpinPage(bm, h));
+        }
+        CHECK(shutdownBufferPool(bm));
+    }
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// NUMA mode keeps the pool semantics; on one node every hit is node-local
+void
+testNumaPartitions (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions opts;
+    int i;
+    testName = "NUMA partitioned pool";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    memset(&opts, 0, sizeof(opts));
+    opts.numaAware = TRUE;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 6, RS_LRU, NULL, &opts));
+    ASSERT_TRUE(getNumaPartitions(bm) >= 1 && getNumaPartitions(bm) <= 6, "partition count within pool size");
+
+    for (i = 0; i < 10; i++)
+    {
+        CHECK(pinPage(bm, h, i % 5));
+        sprintf(h->data, "%s-%i", "Page", h->pageNum);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(5, getNumReadIO(bm), "second round over five pages only hits");
+    if (getNumaPartitions(bm) == 1)
+        ASSERT_TRUE(getNumCrossNodeHits(bm) == 0, "single node has no remote hits");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// grow without losing cached pages, then shrink around a pinned page
+void
+testResize (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+    char expected[64];
+    int i;
+    testName = "Online pool resizing";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+    for (i = 0; i < 4; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "%s-%i", "Page", h->pageNum);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+
+    CHECK(resizeBufferPool(bm, 8));
+    ASSERT_EQUALS_INT(8, bm->numPages, "pool grew to eight frames");
+    ASSERT_EQUALS_POOL("[0x0],[1x0],[2x0],[3x0],[-1 0],[-1 0],[-1 0],[-1 0]", bm, "growing keeps cached pages in place");
+    for (i = 4; i < 8; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "%s-%i", "Page", h->pageNum);
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(8, getNumReadIO(bm), "new frames absorb pages without eviction");
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "no write-back while growing");
+
+    // page 7 stays pinned, so the shrink can only finish once it is released
+    CHECK(pinPage(bm, pinned, 7));
+    CHECK(resizeBufferPool(bm, 3));
+    ASSERT_EQUALS_INT(8, bm->numPages, "shrink waits for the pinned frame");
+    ASSERT_EQUALS_INT(4, getNumWriteIO(bm), "dirty pages leaving the pool are written back");
+    CHECK(unpinPage(bm, pinned));
+    ASSERT_EQUALS_INT(3, bm->numPages, "shrink completes on unpin");
+    ASSERT_EQUALS_POOL("[6 0],[5 0],[7 0]", bm, "hottest pages survive the shrink");
+
+    for (i = 5; i < 8; i++)
+    {
+        sprintf(expected, "%s-%i", "Page", i);
+        CHECK(pinPage(bm, h, i));
+        ASSERT_EQUALS_STRING(expected, h->data, "relocated page keeps its content");
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(8, getNumReadIO(bm), "relocated pages are still hits");
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_FIFO, NULL));
+    for (i = 0; i < 4; i++)
+    {
+        sprintf(expected, "%s-%i", "Page", i);
+        CHECK(pinPage(bm, h, i));
+        ASSERT_EQUALS_STRING(expected, h->data, "evicted page reached disk");
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(bm);
+    free(h);
+    free(pinned);
+    TEST_DONE();
+}
+
+// a thrashing pool takes frames from an idle one while the total stays within budget
+void
+testGovernor (void)
+{
+    BM_BufferPool *hot = MAKE_POOL();
+    BM_BufferPool *idle = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolGovernor gov;
+    int round, i, readsBefore;
+    testName = "Global frame governor";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(createPageFile("testbuffer2.bin"));
+    CHECK(initBufferPool(hot, "testbuffer.bin", 6, RS_LRU, NULL));
+    CHECK(initBufferPool(idle, "testbuffer2.bin", 6, RS_LRU, NULL));
+    CHECK(initPoolGovernor(&gov, 12, 2));
+    CHECK(addGovernedPool(&gov, hot));
+    CHECK(addGovernedPool(&gov, idle));
+    ASSERT_ERROR(addGovernedPool(&gov, hot), "budget is already fully committed");
+
+    // hot loops over eight pages with six frames, idle touches two pages
+    for (round = 0; round < 3; round++)
+    {
+        for (i = 0; i < 40; i++)
+        {
+            CHECK(pinPage(hot, h, i % 8));
+            CHECK(unpinPage(hot, h));
+            CHECK(pinPage(idle, h, i % 2));
+            CHECK(unpinPage(idle, h));
+        }
+        CHECK(rebalancePools(&gov));
+        ASSERT_TRUE(hot->numPages + idle->numPages <= 12, "total frames stay within budget");
+    }
+    ASSERT_EQUALS_INT(8, hot->numPages, "thrashing pool grew to its working set");
+    ASSERT_EQUALS_INT(4, idle->numPages, "idle pool gave up frames");
+
+    readsBefore = getNumReadIO(hot);
+    for (i = 0; i < 40; i++)
+    {
+        CHECK(pinPage(hot, h, i % 8));
+        CHECK(unpinPage(hot, h));
+    }
+    ASSERT_EQUALS_INT(readsBefore, getNumReadIO(hot), "working set now fits");
+
+    // six pages looped through idle's four frames: every second-pass miss is one eviction old
+    CHECK(setGhostListSize(idle, 16));
+    for (i = 0; i < 12; i++)
+    {
+        CHECK(pinPage(idle, h, 10 + i % 6));
+        CHECK(unpinPage(idle, h));
+    }
+    ASSERT_TRUE(getGhostHits(idle, 1) == 0 && getGhostHits(idle, 2) == 6, "ghost hits priced at two frames");
+
+    CHECK(shutdownPoolGovernor(&gov));
+    CHECK(shutdownBufferPool(hot));
+    CHECK(shutdownBufferPool(idle));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    CHECK(destroyPageFile("testbuffer2.bin"));
+
+    free(hot);
+    free(idle);
+    free(h);
+    TEST_DONE();
+}
+
+// the same page number in two files occupies two frames and flushes independently
+void
+testMultiFile (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+    int second;
+    testName = "Multi-file buffer pool";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(createPageFile("testbuffer2.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+    CHECK(openPoolFile(bm, "testbuffer2.bin", &second));
+    ASSERT_TRUE(second != 0, "attached file gets its own id");
+
+    CHECK(pinPage(bm, h, 0));
+    sprintf(h->data, "%s", "file-one");
+    CHECK(markDirty(bm, h));
+    CHECK(pinFilePage(bm, h2, second, 0));
+    sprintf(h2->data, "%s", "file-two");
+    CHECK(markFileDirty(bm, h2, second));
+    ASSERT_EQUALS_POOL("[0x1],[0x1],[-1 0],[-1 0]", bm, "page 0 of both files is cached side by side");
+
+    ASSERT_EQUALS_INT(RC_BM_PAGE_PINNED, closePoolFile(bm, second), "cannot close a file with pinned pages");
+    CHECK(unpinFilePage(bm, h2, second));
+    CHECK(flushPoolFile(bm, second));
+    ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "flushing one file leaves the other dirty");
+    CHECK(closePoolFile(bm, second));
+    ASSERT_EQUALS_POOL("[0x1],[-1 0],[-1 0],[-1 0]", bm, "closing drops the file's frames");
+
+    ASSERT_ERROR(pinFilePage(bm, h2, second, 0), "pin on a closed file");
+    ASSERT_ERROR(closePoolFile(bm, 0), "the pool's own file cannot be closed");
+
+    CHECK(openPoolFile(bm, "testbuffer2.bin", &second));
+    CHECK(pinFilePage(bm, h2, second, 0));
+    ASSERT_EQUALS_STRING("file-two", h2->data, "flushed page reached the second file");
+    ASSERT_EQUALS_STRING("file-one", h->data, "first file's page is untouched");
+    CHECK(unpinFilePage(bm, h2, second));
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    CHECK(destroyPageFile("testbuffer2.bin"));
+    free(bm);
+    free(h);
+    free(h2);
+    TEST_DONE();
+}
+
+// every pin, unpin, eviction and write-back shows up in the 64-bit counters
+void
+testPoolStats (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_Stats stats;
+    int i;
+    testName = "Pool statistics";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+    // pages 0 and 2 dirty, 1 clean; 3 and 4 then evict 0 (dirty) and 1 (clean)
+    for (i = 0; i < 5; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        if (i % 2 == 0)
+            CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPage(bm, h, 4));
+    ASSERT_ERROR(pinPage(bm, h, -1), "negative page number");
+    CHECK(unpinPage(bm, h));
+    CHECK(forceFlushPool(bm));
+
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(stats.pins == 6, "six successful pins");
+    ASSERT_TRUE(stats.hits == 1 && stats.misses == 5, "one hit, five misses");
+    ASSERT_TRUE(stats.failedPins == 1, "one failed pin");
+    ASSERT_TRUE(stats.unpins == 6, "six unpins");
+    ASSERT_TRUE(stats.evictionsDirty == 1 && stats.evictionsClean == 1, "one dirty and one clean eviction");
+    ASSERT_TRUE(stats.flushes == 2, "pages 2 and 4 flushed");
+    ASSERT_TRUE(stats.bytesRead == 5 * PAGE_SIZE && stats.bytesWritten == 3 * PAGE_SIZE, "bytes follow page I/O");
+    ASSERT_EQUALS_INT((int) stats.writeIO, getNumWriteIO(bm), "legacy counter agrees");
+
+    CHECK(resetPoolStats(bm));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(stats.pins == 0 && stats.readIO == 0, "reset clears the counters");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// percentiles come out ordered and every timed operation lands in its own histogram
+void
+testLatencyHistograms (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_LatencySummary sum;
+    LatencyHist io;
+    BM_PageHandle hs[3];
+    PageNumber batch[3] = { 0, 1, 2 };
+    int i;
+    testName = "Latency histograms";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+    CHECK(getLatencySummary(bm, LAT_PIN_HIT, &sum));
+    ASSERT_TRUE(sum.count == 0, "tracking is off by default");
+
+    CHECK(setLatencyTracking(bm, TRUE));
+    setStorageLatencyTracking(TRUE);
+
+    // 6 dirty misses (the last 3 evict a dirty page), then 6 hits on the resident pages
+    for (i = 0; i < 6; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    for (i = 0; i < 6; i++)
+    {
+        CHECK(pinPage(bm, h, 3 + i % 3));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPage(bm, h, 5));
+    CHECK(forcePage(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(forceFlushPool(bm));
+
+    CHECK(getLatencySummary(bm, LAT_PIN_MISS, &sum));
+    ASSERT_TRUE(sum.count == 6, "six misses timed");
+    ASSERT_TRUE(sum.p50Ns <= sum.p99Ns && sum.p99Ns <= sum.p999Ns && sum.p999Ns <= sum.maxNs, "percentiles ordered");
+    CHECK(getLatencySummary(bm, LAT_MISS_EVICT_WRITE, &sum));
+    ASSERT_TRUE(sum.count == 3, "three dirty evictions timed");
+    CHECK(getLatencySummary(bm, LAT_MISS_READ, &sum));
+    ASSERT_TRUE(sum.count == 6, "six reads timed");
+    CHECK(getLatencySummary(bm, LAT_PIN_HIT, &sum));
+    ASSERT_TRUE(sum.count == 7, "seven hits timed");
+    CHECK(getLatencySummary(bm, LAT_FORCE_PAGE, &sum));
+    ASSERT_TRUE(sum.count == 1, "one forcePage timed");
+    CHECK(getLatencySummary(bm, LAT_FORCE_FLUSH_POOL, &sum));
+    ASSERT_TRUE(sum.count == 1, "one forceFlushPool timed");
+    ASSERT_ERROR(getLatencySummary(bm, LAT_NUM_OPS, &sum), "unknown operation");
+
+    CHECK(getStorageLatencyHistogram(SM_LAT_READ, &io));
+    ASSERT_TRUE(io.total == 6, "storage manager timed six reads");
+    CHECK(getStorageLatencyHistogram(SM_LAT_WRITE, &io));
+    ASSERT_TRUE(io.total >= 6, "storage manager timed the write-backs");
+
+    // a batch of misses is one vectored read: one pool sample for the run, one storage sample per page
+    memset(hs, 0, sizeof(hs));
+    CHECK(pinPages(bm, hs, batch, 3));
+    CHECK(unpinPages(bm, hs, 3));
+    CHECK(getLatencySummary(bm, LAT_MISS_READ, &sum));
+    ASSERT_TRUE(sum.count == 7, "batch read timed once");
+    CHECK(getStorageLatencyHistogram(SM_LAT_READ, &io));
+    ASSERT_TRUE(io.total == 9, "storage manager timed each page of the batch");
+
+    setStorageLatencyTracking(FALSE);
+    CHECK(setLatencyTracking(bm, FALSE));
+    CHECK(getLatencySummary(bm, LAT_PIN_MISS, &sum));
+    ASSERT_TRUE(sum.count == 0, "disabling drops the histograms");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// the snapshot walks the pool in caller-sized chunks and agrees with the legacy arrays
+void
+testFrameSnapshot (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_FrameInfo info[2];
+    PageNumber *content;
+    int first, n, i, seen = 0;
+    testName = "Frame snapshot";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_FIFO, NULL));
+    for (i = 0; i < 3; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        if (i == 1)
+        {
+            CHECK(markDirty(bm, h));
+            continue;
+        }
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_POOL("[0 0],[1x1],[2 0],[-1 0],[-1 0]", bm, "printer reads the snapshot");
+
+    content = getFrameContents(bm);
+    for (first = 0; ; first += n)
+    {
+        CHECK(getFrameSnapshot(bm, first, info, 2, &n));
+        if (n == 0)
+            break;
+        for (i = 0; i < n; i++, seen++)
+            ASSERT_EQUALS_INT(content[first + i], info[i].pageNum, "same page as getFrameContents");
+    }
+    free(content);
+    ASSERT_EQUALS_INT(5, seen, "every frame visited once");
+
+    CHECK(getFrameSnapshot(bm, 1, info, 1, &n));
+    ASSERT_TRUE(n == 1 && info[0].dirty && info[0].fixCount == 1 && info[0].fileId == 0, "dirty pinned frame");
+    ASSERT_ERROR(getFrameSnapshot(bm, -1, info, 1, &n), "negative start");
+
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// pin/markDirty/unpin land in the trace file in call order, and a full ring drops instead of blocking
+void
+testAccessTrace (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_BufferPool *other = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    TraceRecord *rec;
+    long n;
+    int i;
+    testName = "Access trace";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+    CHECK(startAccessTrace(bm, "testtrace.bin", 8));
+    ASSERT_ERROR(startAccessTrace(bm, "testtrace.bin", 8), "one trace per pool");
+
+    CHECK(pinPage(bm, h, 7));
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(flushAccessTrace(bm));
+
+    // 3 drained, room for 8 more: 10 pins overflow by 2
+    for (i = 0; i < 5; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_TRUE(getNumTraceDropped(bm) == 2, "two records dropped");
+    CHECK(stopAccessTrace(bm));
+
+    CHECK(readTraceFile("testtrace.bin", &rec, &n));
+    ASSERT_TRUE(n == 11, "eleven records kept");
+    ASSERT_TRUE(rec[0].op == TRACE_PIN && rec[0].pageNum == 7 && rec[0].fileId == 0, "pin first");
+    ASSERT_TRUE(rec[1].op == TRACE_MARK_DIRTY && rec[2].op == TRACE_UNPIN, "then markDirty, unpin");
+    ASSERT_TRUE(rec[0].tsNs <= rec[1].tsNs && rec[1].tsNs <= rec[2].tsNs, "timestamps ordered");
+    ASSERT_TRUE(rec[10].op == TRACE_UNPIN && rec[10].pageNum == 3, "ring kept the oldest records");
+    free(rec);
+
+    // a thread going back and forth between two traced pools keeps one ring in each
+    CHECK(initBufferPool(other, "testbuffer.bin", 3, RS_LRU, NULL));
+    CHECK(startAccessTrace(bm, "testtrace.bin", 1024));
+    CHECK(startAccessTrace(other, "testtrace2.bin", 1024));
+    for (i = 0; i < 300; i++)
+    {
+        CHECK(pinPage(bm, h, i % 4));
+        CHECK(unpinPage(bm, h));
+        CHECK(pinPage(other, h, i % 4));
+        CHECK(unpinPage(other, h));
+    }
+    ASSERT_TRUE(getNumTraceDropped(bm) == 0 && getNumTraceDropped(other) == 0, "nothing dropped on switches");
+    CHECK(stopAccessTrace(bm));
+    CHECK(stopAccessTrace(other));
+    CHECK(readTraceFile("testtrace2.bin", &rec, &n));
+    ASSERT_TRUE(n == 600 && rec[599].thread == 0, "every record in the thread's one ring");
+    free(rec);
+    CHECK(shutdownBufferPool(other));
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    remove("testtrace.bin");
+    remove("testtrace2.bin");
+    free(other);
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// sampling every reference gives exact LRU stack distances: a 10-page loop only fits 10+ frames
+void
+testMissRatioCurve (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_MissRatioCurve curve;
+    BM_Stats stats;
+    MrcSampler s;
+    int i;
+    testName = "Miss-ratio curve";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_LRU, NULL));
+    ASSERT_ERROR(getMissRatioCurve(bm, &curve), "tracking is off");
+    ASSERT_ERROR(setMissRatioTracking(bm, 1.5), "rate above 1");
+    CHECK(setMissRatioTracking(bm, 1.0));
+
+    for (i = 0; i < 50; i++)
+    {
+        CHECK(pinPage(bm, h, i % 10));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(getMissRatioCurve(bm, &curve));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(curve.samples == 50, "every reference sampled");
+    ASSERT_TRUE(curve.numPoints == BM_MRC_POINTS && curve.frames[0] == 2 && curve.frames[7] == 32, "0.25x to 4x");
+    ASSERT_TRUE(curve.frames[3] == 8 && curve.hitRatio[3] == 0.0, "current size predicted");
+    ASSERT_TRUE(stats.hits == 0, "and the pool agrees");
+    ASSERT_TRUE(curve.hitRatio[2] == 0.0 && curve.hitRatio[4] == 0.8, "12 frames hold the loop");
+    ASSERT_TRUE(curve.hitRatio[7] == 0.8, "cold misses remain");
+
+    CHECK(setMissRatioTracking(bm, 0.0));
+    ASSERT_ERROR(getMissRatioCurve(bm, &curve), "disabled again");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+
+    // the sample is fixed-size: a stream of distinct pages lowers the rate instead of growing the table
+    CHECK(initMrcSampler(&s, 1.0));
+    for (i = 0; i < 4 * MRC_MAX_PAGES; i++)
+    {
+        if (mrcSampled(&s, mrcHash(0, i)))
+            mrcAccess(&s, 0, i);
+    }
+    ASSERT_TRUE(s.numPages <= MRC_MAX_PAGES && s.tableSize == 2 * MRC_MAX_PAGES, "table stays bounded");
+    ASSERT_TRUE(s.rate < 0.5 && s.rate > 0.1, "threshold lowered as it filled");
+    ASSERT_TRUE(mrcHitRatio(&s, 4 * MRC_MAX_PAGES) == 0.0, "no page came back");
+    freeMrcSampler(&s);
+    TEST_DONE();
+}
+
+// generators are deterministic per seed, stay in range, and have the shape their name promises
+void
+testWorkloads (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    WorkloadSpec spec;
+    Workload a, b;
+    BM_Stats stats;
+    PageNumber p, q;
+    bool w, v;
+    int i, kind, low = 0, writes = 0;
+    testName = "Workload generators";
+
+    memset(&spec, 0, sizeof(spec));
+    spec.numPages = 1000;
+    spec.theta = 0.99;
+    spec.writeRatio = 0.25;
+    spec.loopPages = 10;
+    spec.hotPages = 50;
+    spec.hotFraction = 0.9;
+    spec.shiftEvery = 100;
+    spec.seed = 7;
+    for (kind = WL_UNIFORM; kind <= WL_TPCC; kind++)
+    {
+        spec.kind = (WorkloadKind) kind;
+        CHECK(initWorkload(&a, &spec));
+        CHECK(initWorkload(&b, &spec));
+        for (i = 0; i < 5000; i++)
+        {
+            nextAccess(&a, &p, &w);
+            nextAccess(&b, &q, &v);
+            if (p != q || w != v || p < 0 || p >= spec.numPages)
+                break;
+        }
+        ASSERT_EQUALS_INT(5000, i, "same seed, same stream, in range");
+    }
+
+    spec.kind = WL_ZIPFIAN;
+    CHECK(initWorkload(&a, &spec));
+    for (i = 0; i < 10000; i++)
+    {
+        nextAccess(&a, &p, &w);
+        low += (p < 100);
+        writes += w;
+    }
+    ASSERT_TRUE(low > 5000, "zipfian: the hottest 10% draw most references");
+    ASSERT_TRUE(writes > 2000 && writes < 3000, "write ratio honoured");
+
+    spec.kind = WL_LOOP_SCAN;
+    CHECK(initWorkload(&a, &spec));
+    for (i = 0; i < 25; i++)
+        nextAccess(&a, &p, &w);
+    ASSERT_EQUALS_INT(4, p, "loop scan wraps at loopPages");
+
+    spec.theta = 1.0;
+    spec.kind = WL_ZIPFIAN;
+    ASSERT_ERROR(initWorkload(&a, &spec), "theta must stay below 1");
+
+    // TPC-C gives each region at least one page; smaller files are refused, not overrun
+    spec.kind = WL_TPCC;
+    spec.numPages = 3;
+    ASSERT_ERROR(initWorkload(&a, &spec), "TPC-C on 3 pages");
+    spec.numPages = 6;
+    ASSERT_ERROR(initWorkload(&a, &spec), "TPC-C on 6 pages");
+    spec.numPages = 7;
+    CHECK(initWorkload(&a, &spec));
+    for (i = 0; i < 5000; i++)
+    {
+        nextAccess(&a, &p, &w);
+        if (p < 0 || p >= spec.numPages)
+            break;
+    }
+    ASSERT_EQUALS_INT(5000, i, "TPC-C on the smallest file stays in range");
+    spec.numPages = 1000;
+
+    // an LRU pool bigger than the loop misses only on the first pass
+    spec.kind = WL_LOOP_SCAN;
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 12, RS_LRU, NULL));
+    CHECK(initWorkload(&a, &spec));
+    CHECK(runWorkload(bm, &a, 100));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(stats.pins == 100 && stats.misses == 10, "driven through the public API");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    TEST_DONE();
+}
+
+typedef struct PoolWorker {
+    BM_BufferPool *bm;
+    Workload wl;
+    RC rc;
+} PoolWorker;
+
+static void *
+runPoolWorker (void *arg)
+{
+    PoolWorker *w = (PoolWorker *) arg;
+    w->rc = runWorkload(w->bm, &w->wl, 2000);
+    return NULL;
+}
+
+// four threads hammer a small concurrent pool; every pin is matched by an unpin and nothing leaks
+void
+testConcurrentPool (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PoolOptions opts;
+    WorkloadSpec spec;
+    PoolWorker workers[4];
+    pthread_t threads[4];
+    BM_Stats stats;
+    BM_FrameInfo info[16];
+    int i, n, pinned = 0;
+    testName = "Concurrent pool";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    memset(&opts, 0, sizeof(opts));
+    opts.concurrent = TRUE;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 16, RS_LRU, NULL, &opts));
+
+    memset(&spec, 0, sizeof(spec));
+    spec.kind = WL_ZIPFIAN;
+    spec.numPages = 64;
+    spec.theta = 0.9;
+    spec.writeRatio = 0.3;
+    for (i = 0; i < 4; i++)
+    {
+        spec.seed = 100 + i;
+        workers[i].bm = bm;
+        CHECK(initWorkload(&workers[i].wl, &spec));
+        ASSERT_TRUE(pthread_create(&threads[i], NULL, runPoolWorker, &workers[i]) == 0, "thread started");
+    }
+    for (i = 0; i < 4; i++)
+    {
+        pthread_join(threads[i], NULL);
+        CHECK(workers[i].rc);
+    }
+
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(stats.pins == 8000 && stats.unpins == 8000, "no pin or unpin lost");
+    ASSERT_TRUE(stats.hits + stats.misses == 8000, "every pin a hit or a miss");
+    ASSERT_TRUE(stats.latchAcquires + stats.latchFreePins + stats.latchFreeUnpins >= 16000, "every call took the latch or the latch-free path");
+    ASSERT_TRUE(stats.latchContended <= stats.latchAcquires, "contention counted");
+    CHECK(getFrameSnapshot(bm, 0, info, 16, &n));
+    for (i = 0; i < n; i++)
+        pinned += info[i].fixCount;
+    ASSERT_EQUALS_INT(0, pinned, "all frames released");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    TEST_DONE();
+}
+
+// sorted page numbers of the resident frames; returns how many
+int
+residentPages (BM_BufferPool *bm, PageNumber *pages, int max)
+{
+    BM_FrameInfo info[16];
+    int i, j, n, count = 0;
+
+    CHECK(getFrameSnapshot(bm, 0, info, 16, &n));
+    for (i = 0; i < n && count < max; i++)
+    {
+        if (info[i].pageNum == NO_PAGE)
+            continue;
+        for (j = count; j > 0 && pages[j - 1] > info[i].pageNum; j--)
+            pages[j] = pages[j - 1];
+        pages[j] = info[i].pageNum;
+        count++;
+    }
+    return count;
+}
+
+// shutdown saves the hottest pages; the next pool reloads them in the background
+void
+testWarmup (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions opts;
+    BM_Stats stats;
+    PageNumber pages[16];
+    char expected[16];
+    int i, n;
+    testName = "Warm-up persistence";
+
+    remove("testbuffer.bin.warm");
+    CHECK(createPageFile("testbuffer.bin"));
+    memset(&opts, 0, sizeof(opts));
+    opts.warmup = TRUE;
+
+    // no sidecar yet: a cold start. LRU keeps 4..11, page 5 touched last
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &opts));
+    CHECK(waitForWarmup(bm));
+    for (i = 0; i < 12; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "%s-%i", "Page", i);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPage(bm, h, 5));
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+
+    // a smaller pool takes the 4 hottest: 5, 11, 10, 9
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &opts));
+    CHECK(waitForWarmup(bm));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(4, (int) stats.warmupLoaded, "hottest pages reloaded");
+    ASSERT_EQUALS_INT(4, (int) stats.readIO, "one read per page, none by the caller");
+    n = residentPages(bm, pages, 16);
+    ASSERT_TRUE(n == 4 && pages[0] == 5 && pages[1] == 9 && pages[2] == 10 && pages[3] == 11, "hottest set resident");
+
+    CHECK(pinPage(bm, h, 11));
+    ASSERT_EQUALS_STRING("Page-11", h->data, "reloaded content");
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(1, (int) stats.hits, "reloaded page is a hit");
+    CHECK(unpinPage(bm, h));
+
+    // reloaded pages keep their saved order below anything touched since: 9 was the coldest
+    CHECK(pinPage(bm, h, 0));
+    CHECK(unpinPage(bm, h));
+    n = residentPages(bm, pages, 16);
+    ASSERT_TRUE(n == 4 && pages[0] == 0 && pages[1] == 5 && pages[2] == 10 && pages[3] == 11, "coldest reloaded page evicted");
+    CHECK(shutdownBufferPool(bm));
+
+    // pins racing the reload see the page content either way
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &opts));
+    for (i = 0; i < 12; i += 5)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(expected, "%s-%i", "Page", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "content while warming up");
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(waitForWarmup(bm));
+    n = residentPages(bm, pages, 16);
+    ASSERT_TRUE(n == 4 && pages[0] == 0 && pages[1] == 5 && pages[2] == 10 && pages[3] == 11, "saved set resident");
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(4, (int) stats.readIO, "each page read once");
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    remove("testbuffer.bin.warm");
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// pinned handles go straight to their frame; hand-built and stale handles still work
+void
+testPageHandles (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *fresh = MAKE_PAGE_HANDLE();
+    BM_PageHandle byHand, stale;
+    int *fix;
+    testName = "Frame-index page handles";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+    CHECK(pinPage(bm, h, 4));
+    sprintf(h->data, "%s-%i", "Page", 4);
+    CHECK(markDirty(bm, h));
+    CHECK(forcePage(bm, h));
+    ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "forcePage through the handle");
+    stale = *h;
+    CHECK(unpinPage(bm, h));
+
+    // only pageNum filled in, the rest left as garbage
+    memset(&byHand, 0x5a, sizeof(byHand));
+    byHand.pageNum = 4;
+    CHECK(pinPage(bm, h, 4));
+    CHECK(markDirty(bm, &byHand));
+    CHECK(unpinPage(bm, &byHand));
+    fix = getFixCounts(bm);
+    ASSERT_EQUALS_INT(0, fix[0], "hand-built handle unpinned the page");
+    free(fix);
+
+    // page 4 is evicted and comes back in another frame; the old handle names page 7's frame now
+    CHECK(pinPage(bm, h, 5));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, 6));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, 7));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_POOL("[7 0],[5 0],[6 0]", bm, "page 4 evicted");
+    CHECK(pinPage(bm, h, 4));
+    ASSERT_EQUALS_STRING("Page-4", h->data, "dirty page written back on eviction");
+    ASSERT_TRUE(stale.frameIdx != h->frameIdx, "reloaded elsewhere");
+    CHECK(pinPage(bm, h, 7));
+    CHECK(unpinPage(bm, &stale));
+    ASSERT_EQUALS_POOL("[7 1],[4 0],[6 0]", bm, "stale handle unpinned page 4, not its old frame");
+
+    // a zeroed handle names frame 0 with generation 0, which no resident page has
+    ASSERT_TRUE(fresh->frameIdx == 0 && fresh->frameGen == 0, "MAKE_PAGE_HANDLE zeroes the frame hint");
+    CHECK(pinPage(bm, &stale, 6));
+    fresh->pageNum = 6;
+    CHECK(unpinPage(bm, fresh));
+    ASSERT_EQUALS_POOL("[7 1],[4 0],[6 0]", bm, "zeroed handle unpinned page 6, not frame 0");
+    CHECK(unpinPage(bm, h));
+
+    stale.pageNum = 9;
+    ASSERT_ERROR(markDirty(bm, &stale), "stale handle for a page not in the pool");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    free(fresh);
+    TEST_DONE();
+}
+
+// one call pins several pages; runs of missing pages come in as one read each
+void
+testBatchPins (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle hs[6];
+    PageNumber want[5] = { 3, 1, 2, 1, 7 };
+    PageNumber tooMany[5] = { 10, 11, 12, 13, 14 };
+    PageNumber repeatedMiss[6] = { 20, 20, 21, 22, 23, 24 };
+    BM_Stats stats;
+    char expected[16];
+    int *fix;
+    int i;
+    testName = "Batch pin and unpin";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+    for (i = 0; i < 8; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "%s-%i", "Page", i);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(forceFlushPool(bm));
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+    CHECK(pinPages(bm, hs, want, 5));
+    for (i = 0; i < 5; i++)
+    {
+        sprintf(expected, "%s-%i", "Page", want[i]);
+        ASSERT_EQUALS_STRING(expected, hs[i].data, "handle in caller order");
+    }
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(4, (int) stats.misses, "one miss per distinct page");
+    ASSERT_EQUALS_INT(1, (int) stats.hits, "repeated page shares its frame");
+    ASSERT_EQUALS_INT(4, (int) stats.readIO, "pages read");
+    ASSERT_TRUE(hs[1].data == hs[3].data, "same frame for the same page");
+    fix = getFixCounts(bm);
+    ASSERT_EQUALS_INT(5, fix[0] + fix[1] + fix[2] + fix[3], "every entry pinned");
+    free(fix);
+
+    // all frames pinned: the batch fails and leaves nothing pinned behind
+    ASSERT_ERROR(pinPages(bm, hs, tooMany, 2), "no frame left");
+    CHECK(unpinPages(bm, hs, 5));
+    fix = getFixCounts(bm);
+    ASSERT_EQUALS_INT(0, fix[0] + fix[1] + fix[2] + fix[3], "every entry unpinned");
+    free(fix);
+
+    // five distinct pages do not fit in four frames
+    ASSERT_ERROR(pinPages(bm, hs, tooMany, 5), "batch larger than the pool");
+    fix = getFixCounts(bm);
+    ASSERT_EQUALS_INT(0, fix[0] + fix[1] + fix[2] + fix[3], "failed batch releases its pins");
+    free(fix);
+    // a repeated miss shares its frame; the rollback releases both pins before clearing it
+    ASSERT_ERROR(pinPages(bm, hs, repeatedMiss, 6), "repeated miss in a batch too large");
+    fix = getFixCounts(bm);
+    ASSERT_EQUALS_INT(0, fix[0] + fix[1] + fix[2] + fix[3], "repeated miss released");
+    free(fix);
+    // pages past the end of the file grow it and read as zeros
+    CHECK(pinPages(bm, hs, tooMany, 4));
+    for (i = 0; i < 4; i++)
+        ASSERT_TRUE(hs[i].pageNum == tooMany[i] && hs[i].data[0] == '\0', "new page is empty");
+    CHECK(unpinPages(bm, hs, 4));
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// new pages are zeroed and dirty in memory; only write-back touches the file
+void
+testNewPages (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    SM_FileHandle fh;
+    BM_Stats stats;
+    PageNumber p;
+    char expected[16];
+    int i;
+    testName = "pinNewPage";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+    for (i = 1; i <= 3; i++)
+    {
+        CHECK(pinNewPage(bm, h, &p));
+        ASSERT_EQUALS_INT(i, p, "next page past the end");
+        ASSERT_TRUE(h->data[0] == '\0' && h->data[PAGE_SIZE - 1] == '\0', "zero-filled");
+        sprintf(h->data, "%s-%i", "Page", p);
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_POOL("[1x0],[2x0],[3x0]", bm, "new pages dirty");
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(0, (int) stats.readIO, "no reads");
+    ASSERT_EQUALS_INT(0, (int) stats.writeIO, "no writes yet");
+    ASSERT_EQUALS_INT(3, (int) stats.newPages, "new pages counted");
+
+    // out of order write-back leaves no hole
+    h->pageNum = 3;
+    CHECK(forcePage(bm, h));
+    CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(3, getNumWriteIO(bm), "one write per new page");
+
+    // a pinPage past the end still grows the file; pinNewPage continues after it
+    CHECK(pinPage(bm, h, 6));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinNewPage(bm, h, &p));
+    ASSERT_EQUALS_INT(7, p, "allocation follows the grown file");
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    ASSERT_EQUALS_INT(8, fh.totalNumPages, "file holds every page");
+    CHECK(closePageFile(&fh));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+    for (i = 1; i <= 3; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(expected, "%s-%i", "Page", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "content written back");
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// unpin and dirty in one latch round trip, with the modified bytes remembered
+void
+testUnpinDirty (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions opts;
+    BM_FrameInfo info[2];
+    BM_Stats stats;
+    int n;
+    testName = "Unpin with dirty";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    memset(&opts, 0, sizeof(opts));
+    opts.concurrent = TRUE;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 2, RS_FIFO, NULL, &opts));
+
+    CHECK(pinPage(bm, h, 0));
+    CHECK(resetPoolStats(bm));
+    CHECK(unpinPageDirty(bm, h, FALSE));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(1, (int) stats.latchAcquires, "a clean unpin skips the latch; only getPoolStats takes it");
+    ASSERT_EQUALS_INT(1, (int) stats.latchFreeUnpins, "unpinned latch-free");
+    ASSERT_EQUALS_POOL("[0 0],[-1 0]", bm, "clean unpin");
+
+    CHECK(pinPage(bm, h, 0));
+    CHECK(unpinPageDirty(bm, h, TRUE));
+    ASSERT_EQUALS_POOL("[0x0],[-1 0]", bm, "dirty unpin");
+    CHECK(getFrameSnapshot(bm, 0, info, 2, &n));
+    ASSERT_TRUE(info[0].dirtyFrom == 0 && info[0].dirtyTo == PAGE_SIZE, "whole page modified");
+    CHECK(forceFlushPool(bm));
+
+    // ranges of one dirty period merge; write-back starts over
+    CHECK(pinPage(bm, h, 1));
+    memcpy(h->data + 100, "abcd", 4);
+    CHECK(unpinPageDirtyRange(bm, h, 100, 4));
+    CHECK(pinPage(bm, h, 1));
+    memcpy(h->data + 10, "xyz", 3);
+    CHECK(unpinPageDirtyRange(bm, h, 10, 3));
+    CHECK(getFrameSnapshot(bm, 0, info, 2, &n));
+    ASSERT_TRUE(info[1].dirty && info[1].dirtyFrom == 10 && info[1].dirtyTo == 104, "ranges merged");
+    ASSERT_EQUALS_INT(0, info[0].dirtyTo, "clean frame has no range");
+    CHECK(forceFlushPool(bm));
+    CHECK(pinPage(bm, h, 1));
+    CHECK(unpinPageDirtyRange(bm, h, 200, 1));
+    CHECK(getFrameSnapshot(bm, 0, info, 2, &n));
+    ASSERT_TRUE(info[1].dirtyFrom == 200 && info[1].dirtyTo == 201, "range restarts after write-back");
+
+    // a bad range changes nothing, the page stays pinned
+    CHECK(pinPage(bm, h, 1));
+    ASSERT_ERROR(unpinPageDirtyRange(bm, h, PAGE_SIZE - 2, 4), "range past the page");
+    CHECK(getFrameSnapshot(bm, 0, info, 2, &n));
+    ASSERT_EQUALS_INT(1, info[1].fixCount, "still pinned");
+    CHECK(unpinPageDirtyRange(bm, h, 0, 0));
+    ASSERT_EQUALS_POOL("[0 0],[1x0]", bm, "zero length just unpins");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// scans and one-shot pins stay out of the working set, keep-hot pages outlive it
+void
+testAccessHints (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    SM_FileHandle fh;
+    BM_PoolOptions opts;
+    BM_Stats stats;
+    int p;
+    testName = "Access-pattern hints";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    CHECK(ensureCapacity(30, &fh));
+    CHECK(closePageFile(&fh));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 6, RS_LRU, NULL));
+
+    // a scan miss reads ahead into the empty frames, its hits cost no I/O
+    for (p = 0; p < 2; p++)
+    {
+        CHECK(pinPage(bm, h, p));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPageHinted(bm, h, 10, AH_SCAN));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(3, (int) stats.readAhead, "read ahead up to the empty frames");
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[10 1],[11 0],[12 0],[13 0]", bm, "scan window loaded");
+    CHECK(unpinPage(bm, h));
+    for (p = 11; p < 14; p++)
+    {
+        CHECK(pinPageHinted(bm, h, p, AH_SCAN));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(6, getNumReadIO(bm), "read-ahead pages hit");
+
+    // the next window reuses the frames the scan went through, the working set stays
+    CHECK(pinPageHinted(bm, h, 14, AH_SCAN));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[14 1],[15 0],[16 0],[17 0]", bm, "scan replaced only its own pages");
+    CHECK(unpinPage(bm, h));
+
+    // a page used once is the next victim
+    CHECK(pinPageHinted(bm, h, 2, AH_ONCE));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[15 0],[16 0],[17 0]", bm, "once page took the used scan page");
+    CHECK(pinPage(bm, h, 3));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[3 0],[15 0],[16 0],[17 0]", bm, "once page evicted first");
+
+    // random access never reads ahead
+    CHECK(getPoolStats(bm, &stats));
+    p = (int) stats.readAhead;
+    CHECK(pinPageHinted(bm, h, 20, AH_RANDOM));
+    CHECK(unpinPage(bm, h));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(p, (int) stats.readAhead, "no read-ahead");
+    ASSERT_ERROR(pinPageHinted(bm, h, 0, (BM_AccessHint) 9), "unknown hint");
+    CHECK(shutdownBufferPool(bm));
+
+    // keep-hot pages survive a stream of misses until the segment demotes them
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+    CHECK(pinPageHinted(bm, h, 0, AH_KEEP_HOT));
+    CHECK(unpinPage(bm, h));
+    for (p = 1; p < 12; p++)
+    {
+        CHECK(pinPage(bm, h, p));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_POOL("[0 0],[10 0],[11 0],[9 0]", bm, "protected page stayed");
+    CHECK(pinPageHinted(bm, h, 11, AH_KEEP_HOT));
+    CHECK(unpinPage(bm, h));
+    for (p = 12; p < 15; p++)
+    {
+        CHECK(pinPage(bm, h, p));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_POOL("[12 0],[14 0],[11 0],[13 0]", bm, "demoted page evicted in LRU order");
+    CHECK(shutdownBufferPool(bm));
+
+    // a latch-free hit ends read-ahead status too, so the scan's later pin keeps the page warm
+    memset(&opts, 0, sizeof(opts));
+    opts.concurrent = TRUE;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 6, RS_LRU, NULL, &opts));
+    for (p = 0; p < 2; p++)
+    {
+        CHECK(pinPage(bm, h, p));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPageHinted(bm, h, 10, AH_SCAN));
+    CHECK(unpinPage(bm, h));
+    CHECK(resetPoolStats(bm));
+    CHECK(pinPage(bm, h, 11));
+    CHECK(unpinPage(bm, h));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(1, (int) stats.latchFreePins, "read-ahead page hit without the latch");
+    for (p = 11; p < 14; p++)
+    {
+        CHECK(pinPageHinted(bm, h, p, AH_SCAN));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPageHinted(bm, h, 14, AH_SCAN));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[14 1],[11 0],[15 0],[16 0]", bm, "used page not taken by the scan");
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// high-priority pages hold their frames within the reserved share, low ones go first
+void
+testPagePriority (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions opts;
+    BM_FrameInfo info[4];
+    BM_Stats stats;
+    int p, n;
+    testName = "Page priority classes";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    memset(&opts, 0, sizeof(opts));
+    opts.highPriorityShare = 0.5;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &opts));
+
+    // two of four frames may hold high pages
+    for (p = 0; p < 3; p++)
+    {
+        CHECK(pinPage(bm, h, p));
+        if (p < 2)
+        {
+            CHECK(setPagePriority(bm, h, PP_HIGH));
+        }
+        else
+        {
+            ASSERT_EQUALS_INT(RC_BM_BUDGET_EXCEEDED, setPagePriority(bm, h, PP_HIGH), "reserved region full");
+        }
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPage(bm, h, 3));
+    CHECK(setPagePriority(bm, h, PP_LOW));
+    CHECK(unpinPage(bm, h));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(stats.classFrames[PP_HIGH] == 2 && stats.classFrames[PP_NORMAL] == 1 && stats.classFrames[PP_LOW] == 1,
+                "occupancy per class");
+
+    // the low page goes first, then only the normal frames turn over
+    CHECK(pinPage(bm, h, 4));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[4 0]", bm, "low page evicted before older normal ones");
+    for (p = 5; p < 10; p++)
+    {
+        CHECK(pinPage(bm, h, p));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[9 0],[8 0]", bm, "high pages stayed");
+    CHECK(getFrameSnapshot(bm, 0, info, 4, &n));
+    ASSERT_TRUE(info[0].priority == PP_HIGH && info[2].priority == PP_NORMAL, "class in the snapshot");
+
+    // with every normal frame pinned a high page is still a victim
+    CHECK(pinPage(bm, h, 8));
+    CHECK(pinPage(bm, h, 9));
+    CHECK(pinPage(bm, h, 10));
+    ASSERT_EQUALS_POOL("[10 1],[1 0],[9 1],[8 1]", bm, "high page taken last");
+    CHECK(unpinPage(bm, h));
+    h->pageNum = 8;
+    CHECK(unpinPage(bm, h));
+    h->pageNum = 9;
+    CHECK(unpinPage(bm, h));
+
+    // a class can be lowered again, freeing room in the reserved region
+    CHECK(pinPage(bm, h, 1));
+    CHECK(setPagePriority(bm, h, PP_NORMAL));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, 8));
+    CHECK(setPagePriority(bm, h, PP_HIGH));
+    CHECK(unpinPage(bm, h));
+    ASSERT_ERROR(setPagePriority(bm, h, BM_NUM_PRIORITIES), "unknown class");
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// discarded pages leave the pool without a write-back
+void
+testDiscard (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_Stats stats;
+    int p;
+    testName = "Discard pages";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_FIFO, NULL));
+    for (p = 0; p < 4; p++)
+    {
+        CHECK(pinPage(bm, h, p));
+        sprintf(h->data, "%s-%i", "Dropped", p);
+        CHECK(unpinPageDirty(bm, h, TRUE));
+    }
+
+    // a pinned page in the range stops the whole call
+    CHECK(pinPage(bm, h, 2));
+    ASSERT_EQUALS_INT(RC_BM_PAGE_PINNED, discardRange(bm, 1, 3), "pinned page");
+    ASSERT_EQUALS_POOL("[0x0],[1x0],[2x1],[3x0]", bm, "nothing dropped");
+    CHECK(unpinPage(bm, h));
+
+    CHECK(discardRange(bm, 1, 3));
+    ASSERT_EQUALS_POOL("[0x0],[-1 0],[-1 0],[3x0]", bm, "range dropped");
+    CHECK(discardPage(bm, 7));
+    CHECK(discardPage(bm, 3));
+    ASSERT_EQUALS_POOL("[0x0],[-1 0],[-1 0],[-1 0]", bm, "single page dropped, absent page ignored");
+    ASSERT_ERROR(discardRange(bm, 3, 1), "reversed range");
+    ASSERT_ERROR(discardPage(bm, -1), "negative page");
+    ASSERT_ERROR(discardPage(bm, INT_MAX), "page without an end");
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(stats.discarded == 3 && stats.discardedDirty == 3, "discards counted");
+
+    CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "only the kept page written");
+
+    // the freed frames are reused without eviction, and the dropped data never reached disk
+    CHECK(pinPage(bm, h, 1));
+    ASSERT_TRUE(h->data[0] == '\0', "dropped page not on disk");
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[-1 0],[-1 0]", bm, "empty frame taken first");
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+#define PT_TEST_KEYS 64
+#define PT_TEST_WRITERS 4
+#define PT_TEST_READERS 4
+
+typedef struct PtStress {
+    PageTable table;
+    _Atomic int started[PT_TEST_KEYS]; // toggles begun on each key
+    _Atomic int version[PT_TEST_KEYS]; // toggles done: odd means present, with that value
+    _Atomic bool stop;
+} PtStress;
+
+typedef struct PtWorker {
+    PtStress *st;
+    int id;
+    int violations;
+} PtWorker;
+
+static void *
+runPtWriter (void *arg)
+{
+    PtWorker *w = (PtWorker *) arg;
+    PtStress *st = w->st;
+    int round, k;
+
+    // each writer owns the keys k with k % PT_TEST_WRITERS == id, so its toggles are ordered
+    for (round = 0; round < 2000; round++)
+        for (k = w->id; k < PT_TEST_KEYS; k += PT_TEST_WRITERS)
+        {
+            int v = atomic_load(&st->version[k]);
+            atomic_store(&st->started[k], v + 1);
+            if (v % 2 == 0)
+            {
+                if (ptInsert(&st->table, 0, k, v + 1) != RC_OK)
+                    w->violations++;
+            }
+            else if (!ptRemove(&st->table, 0, k))
+                w->violations++;
+            atomic_store(&st->version[k], v + 1);
+        }
+    return NULL;
+}
+
+static void *
+runPtReader (void *arg)
+{
+    PtWorker *w = (PtWorker *) arg;
+    PtStress *st = w->st;
+    unsigned int seed = 7 + w->id;
+
+    while (!atomic_load(&st->stop))
+    {
+        int k = rand_r(&seed) % PT_TEST_KEYS;
+        bool inside = ptEnter(&st->table);
+        int v0 = atomic_load(&st->version[k]);
+        int got = ptLookup(&st->table, 0, k);
+        int v1 = atomic_load(&st->started[k]);
+        if (inside)
+            ptExit(&st->table);
+
+        // linearizable: the key was in some state v0..v1 during the lookup, and the result is one of them
+        if (got == -1)
+        {
+            if (v0 % 2 == 1 && v1 == v0)
+                w->violations++;
+        }
+        else if (got % 2 == 0 || got < v0 || got > v1)
+            w->violations++;
+    }
+    return NULL;
+}
+
+static void *
+runPtVisitor (void *arg)
+{
+    PageTable *pt = (PageTable *) arg;
+
+    // enters once and exits the thread, which gives its slot back
+    if (!ptEnter(pt))
+        return NULL;
+    ptExit(pt);
+    return pt;
+}
+
+// concurrent inserts, removes and lookups on a small table: every lookup sees a state the key
+// actually passed through, and retired nodes are reclaimed without a reader ever touching freed memory
+void
+testPageTable (void)
+{
+    PtStress *st = calloc(1, sizeof(PtStress));
+    PtWorker writers[PT_TEST_WRITERS], readers[PT_TEST_READERS];
+    pthread_t wt[PT_TEST_WRITERS], rt[PT_TEST_READERS];
+    int i, slots, violations = 0;
+    testName = "Lock-free page table";
+
+    CHECK(initPageTable(&st->table, 8)); // 16 buckets for 64 keys: long chains, frequent CAS conflicts
+    for (i = 0; i < PT_TEST_READERS; i++)
+    {
+        readers[i].st = st;
+        readers[i].id = i;
+        readers[i].violations = 0;
+        ASSERT_TRUE(pthread_create(&rt[i], NULL, runPtReader, &readers[i]) == 0, "reader started");
+    }
+    for (i = 0; i < PT_TEST_WRITERS; i++)
+    {
+        writers[i].st = st;
+        writers[i].id = i;
+        writers[i].violations = 0;
+        ASSERT_TRUE(pthread_create(&wt[i], NULL, runPtWriter, &writers[i]) == 0, "writer started");
+    }
+    for (i = 0; i < PT_TEST_WRITERS; i++)
+    {
+        pthread_join(wt[i], NULL);
+        violations += writers[i].violations;
+    }
+    atomic_store(&st->stop, TRUE);
+    for (i = 0; i < PT_TEST_READERS; i++)
+    {
+        pthread_join(rt[i], NULL);
+        violations += readers[i].violations;
+    }
+    ASSERT_EQUALS_INT(0, violations, "every insert, remove and lookup linearizable");
+
+    // 2000 toggles per key leave every key absent
+    for (i = 0; i < PT_TEST_KEYS; i++)
+        if (ptLookup(&st->table, 0, i) != -1)
+            violations++;
+    ASSERT_EQUALS_INT(0, violations, "all keys removed");
+    CHECK(ptInsert(&st->table, 3, 5, 42));
+    ASSERT_EQUALS_INT(42, ptLookup(&st->table, 3, 5), "fileId is part of the key");
+    ASSERT_EQUALS_INT(-1, ptLookup(&st->table, 5, 3), "fileId and pageNum not interchangeable");
+
+    // more threads than slots over time, never at once
+    slots = atomic_load(&st->table.numThreads);
+    for (i = 0; i < PT_MAX_THREADS + 44; i++)
+    {
+        void *entered = NULL;
+        ASSERT_TRUE(pthread_create(&wt[0], NULL, runPtVisitor, &st->table) == 0, "visitor started");
+        pthread_join(wt[0], &entered);
+        if (entered == NULL)
+            violations++;
+    }
+    ASSERT_EQUALS_INT(0, violations, "every short-lived thread got a slot");
+    ASSERT_TRUE(atomic_load(&st->table.numThreads) <= slots + 1, "exited threads' slots reused");
+
+    // rebucketing keeps every key and its value
+    for (i = 0; i < 4 * PT_TEST_KEYS; i++)
+        CHECK(ptInsert(&st->table, 1, i, i));
+    CHECK(ptRehash(&st->table, 4 * PT_TEST_KEYS));
+    ASSERT_TRUE(st->table.mask + 1 == 8 * PT_TEST_KEYS, "buckets for twice the keys");
+    for (i = 0; i < 4 * PT_TEST_KEYS; i++)
+        if (ptLookup(&st->table, 1, i) != i)
+            violations++;
+    ASSERT_EQUALS_INT(0, violations, "keys found after rehash");
+    ASSERT_EQUALS_INT(42, ptLookup(&st->table, 3, 5), "earlier key kept");
+    freePageTable(&st->table);
+
+    free(st);
+    TEST_DONE();
+}
+
+typedef struct StampWorker {
+    BM_BufferPool *bm;
+    int id;
+    int bad;
+    RC rc;
+} StampWorker;
+
+static void *
+runStampWorker (void *arg)
+{
+    StampWorker *w = (StampWorker *) arg;
+    BM_PageHandle h;
+    char expect[32];
+    unsigned int seed = 31 + w->id;
+    int i;
+
+    for (i = 0; i < 20000 && w->rc == RC_OK; i++)
+    {
+        // a hot set that mostly hits, and a tail that forces evictions under the readers
+        int p = (rand_r(&seed) % 4 != 0) ? rand_r(&seed) % 6 : rand_r(&seed) % 40;
+        w->rc = pinPage(w->bm, &h, p);
+        if (w->rc != RC_OK)
+            break;
+        sprintf(expect, "%s-%i", "Stamp", p);
+        if (h.pageNum != p || strcmp(h.data, expect) != 0)
+            w->bad++;
+        w->rc = unpinPage(w->bm, &h);
+    }
+    return NULL;
+}
+
+// pins that hit go around the latch; the page under a pin is always the one asked for,
+// while misses evict and a resize moves the frame table under them
+void
+testLatchFreePins (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions opts;
+    StampWorker workers[4];
+    pthread_t threads[4];
+    BM_FrameInfo info[16];
+    BM_Stats stats;
+    BM_MissRatioCurve curve;
+    int i, n, bad = 0, pinned = 0;
+    testName = "Latch-free pins";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_LRU, NULL));
+    for (i = 0; i < 40; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "%s-%i", "Stamp", i);
+        CHECK(unpinPageDirty(bm, h, TRUE));
+    }
+    CHECK(shutdownBufferPool(bm));
+
+    memset(&opts, 0, sizeof(opts));
+    opts.concurrent = TRUE;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &opts));
+    CHECK(setMissRatioTracking(bm, 0.5)); // the sampler locks for itself and keeps the latch-free path open
+    for (i = 0; i < 4; i++)
+    {
+        workers[i].bm = bm;
+        workers[i].id = i;
+        workers[i].bad = 0;
+        workers[i].rc = RC_OK;
+        ASSERT_TRUE(pthread_create(&threads[i], NULL, runStampWorker, &workers[i]) == 0, "thread started");
+    }
+    for (i = 0; i < 50; i++)
+        CHECK(resizeBufferPool(bm, (i % 2 == 0) ? 16 : 8));
+    for (i = 0; i < 4; i++)
+    {
+        pthread_join(threads[i], NULL);
+        CHECK(workers[i].rc);
+        bad += workers[i].bad;
+    }
+    ASSERT_EQUALS_INT(0, bad, "every pin saw its own page");
+
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(stats.pins == 80000 && stats.unpins == 80000, "no pin or unpin lost");
+    ASSERT_TRUE(stats.hits + stats.misses == 80000, "every pin a hit or a miss");
+    ASSERT_TRUE(stats.latchFreePins > 0 && stats.latchFreeUnpins > 0, "hits and unpins skipped the latch");
+    CHECK(getMissRatioCurve(bm, &curve));
+    ASSERT_TRUE(curve.samples > 0 && curve.samples < 80000, "half the pages sampled on both paths");
+    CHECK(setMissRatioTracking(bm, 0.0));
+    CHECK(getFrameSnapshot(bm, 0, info, 16, &n));
+    for (i = 0; i < n; i++)
+        pinned += info[i].fixCount;
+    ASSERT_EQUALS_INT(0, pinned, "all frames released");
+
+    // tracking needs the latch on every call, so it closes the latch-free path
+    CHECK(setLatencyTracking(bm, TRUE));
+    CHECK(resetPoolStats(bm));
+    CHECK(pinPage(bm, h, 0));
+    CHECK(unpinPage(bm, h));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(stats.latchFreePins == 0 && stats.latchFreeUnpins == 0, "latch path while tracking");
+    CHECK(setLatencyTracking(bm, FALSE));
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// child slots become frame references while the child is resident, and page numbers again
+// when it leaves, moves or is replaced; the disk only ever sees page numbers
+void
+testSwizzling (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *c = MAKE_PAGE_HANDLE();
+    BM_PoolOptions opts;
+    BM_Stats stats;
+    SM_FileHandle fh;
+    char *disk = malloc(PAGE_SIZE);
+    PageNumber child;
+    int p;
+    testName = "Swizzled child references";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+    CHECK(pinPage(bm, h, 0));
+    ((int64_t *) h->data)[0] = 5;
+    ((int64_t *) h->data)[1] = 6;
+    CHECK(unpinPageDirty(bm, h, TRUE));
+    for (p = 5; p <= 6; p++)
+    {
+        CHECK(pinPage(bm, h, p));
+        sprintf(h->data, "%s-%i", "Child", p);
+        CHECK(unpinPageDirty(bm, h, TRUE));
+    }
+    CHECK(shutdownBufferPool(bm));
+
+    memset(&opts, 0, sizeof(opts));
+    opts.concurrent = TRUE;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &opts));
+    CHECK(pinPage(bm, h, 0));
+
+    // the first pin goes by page number and swizzles the slot, the second follows the reference
+    CHECK(pinChild(bm, h, 0, c));
+    ASSERT_EQUALS_INT(5, c->pageNum, "child page");
+    ASSERT_EQUALS_STRING("Child-5", c->data, "child content");
+    ASSERT_TRUE(((int64_t *) h->data)[0] < 0, "slot swizzled");
+    CHECK(unpinPage(bm, c));
+    CHECK(pinChild(bm, h, 0, c));
+    ASSERT_EQUALS_STRING("Child-5", c->data, "child through the reference");
+    CHECK(unpinPage(bm, c));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(stats.swizzledPins == 1 && stats.latchFreePins == 1, "second pin skipped lookup and latch");
+    CHECK(getChildPageNum(bm, h, 0, &child));
+    ASSERT_EQUALS_INT(5, child, "slot reads as a page number");
+
+    // evicting the child puts its page number back
+    for (p = 10; p <= 12; p++)
+    {
+        CHECK(pinPage(bm, c, p));
+        CHECK(unpinPage(bm, c));
+    }
+    ASSERT_EQUALS_POOL("[0 1],[12 0],[10 0],[11 0]", bm, "child evicted");
+    ASSERT_TRUE(((int64_t *) h->data)[0] == 5, "slot unswizzled");
+
+    // a write-back carries page numbers while the frame keeps its references
+    CHECK(pinChild(bm, h, 8, c));
+    ASSERT_EQUALS_POOL("[0 1],[12 0],[6 1],[11 0]", bm, "second child loaded");
+    CHECK(markDirty(bm, h));
+    CHECK(forcePage(bm, h));
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    CHECK(readBlock(0, &fh, disk));
+    CHECK(closePageFile(&fh));
+    ASSERT_TRUE(((int64_t *) disk)[0] == 5 && ((int64_t *) disk)[1] == 6, "disk holds page numbers");
+    ASSERT_TRUE(((int64_t *) h->data)[1] < 0, "memory keeps the reference");
+    CHECK(unpinPage(bm, c));
+
+    // a shrink that moves the child repoints the slot
+    CHECK(resizeBufferPool(bm, 2));
+    ASSERT_EQUALS_POOL("[0 1],[6 0]", bm, "child moved");
+    CHECK(pinChild(bm, h, 8, c));
+    ASSERT_EQUALS_STRING("Child-6", c->data, "moved child through the reference");
+    CHECK(unpinPage(bm, c));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_TRUE(stats.swizzledPins == 2, "still swizzled after the move");
+
+    // replacing a swizzled slot drops the reference
+    CHECK(setChildPageNum(bm, h, 8, 7));
+    ASSERT_TRUE(((int64_t *) h->data)[1] == 7, "slot replaced");
+    CHECK(getChildPageNum(bm, h, 8, &child));
+    ASSERT_EQUALS_INT(7, child, "new child");
+    CHECK(pinChild(bm, h, 8, c));
+    ASSERT_EQUALS_POOL("[0 1],[7 1]", bm, "old child evicted for the new one");
+    CHECK(unpinPage(bm, c));
+
+    // an evicted parent lets go of its children
+    CHECK(pinChild(bm, h, 0, c));
+    CHECK(unpinPage(bm, c));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, c, 20));
+    CHECK(unpinPage(bm, c));
+    ASSERT_EQUALS_POOL("[20 0],[5 0]", bm, "parent evicted");
+    CHECK(pinPage(bm, h, 0));
+    CHECK(pinChild(bm, h, 0, c));
+    ASSERT_EQUALS_STRING("Child-5", c->data, "child pinned again by page number");
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(3, (int) stats.unswizzled, "unswizzled on both child evictions and the parent's");
+
+    // negative bytes that are no reference of this slot are never taken for a frame
+    ((int64_t *) h->data)[2] = -1000000;
+    ASSERT_ERROR(pinChild(bm, h, 16, c), "garbage slot far out of range");
+    ((int64_t *) h->data)[2] = INT64_MIN;
+    ASSERT_ERROR(pinChild(bm, h, 16, c), "garbage slot at the int64 limit");
+    ((int64_t *) h->data)[2] = -2;
+    ASSERT_ERROR(pinChild(bm, h, 16, c), "slot naming a frame that is not its child");
+    ASSERT_ERROR(getChildPageNum(bm, h, 16, &child), "garbage slot unreadable");
+    CHECK(setChildPageNum(bm, h, 16, 5));
+    CHECK(getChildPageNum(bm, h, 16, &child));
+    ASSERT_EQUALS_INT(5, child, "garbage slot overwritten");
+    ((int64_t *) h->data)[2] = 0;
+    ASSERT_EQUALS_POOL("[5 1],[0 1]", bm, "no stray pins");
+    ASSERT_ERROR(pinChild(bm, h, 3, c), "unaligned slot");
+    ASSERT_ERROR(pinChild(bm, h, PAGE_SIZE - 4, c), "slot past the page");
+    CHECK(unpinPage(bm, c));
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(disk);
+    free(bm);
+    free(h);
+    free(c);
+    TEST_DONE();
+}
+
+typedef struct FlushWatch {
+    BM_BufferPool *bm;
+    int calls;
+    int monotonic;
+    uint64_t lastDone;
+    uint64_t lastTotal;
+    RC rc;
+} FlushWatch;
+
+static void
+watchFlush (uint64_t pagesDone, uint64_t pagesTotal, void *arg)
+{
+    FlushWatch *w = (FlushWatch *) arg;
+    BM_PageHandle h;
+    BM_Stats stats;
+
+    if (pagesDone <= w->lastDone || pagesDone > pagesTotal)
+        w->monotonic = 0;
+    w->lastDone = pagesDone;
+    w->lastTotal = pagesTotal;
+
+    // getPoolStats takes the latch, so the flush must not hold it here
+    if (w->rc == RC_OK)
+        w->rc = getPoolStats(w->bm, &stats);
+    w->calls++;
+    if (pagesDone == pagesTotal && w->rc == RC_OK)
+    {
+        // every batch is written; changing page 0 now leaves it dirty
+        w->rc = pinPage(w->bm, &h, 0);
+        if (w->rc != RC_OK)
+            return;
+        sprintf(h.data, "%s-%i", "Again", 0);
+        w->rc = markDirty(w->bm, &h);
+        if (w->rc == RC_OK)
+            w->rc = unpinPage(w->bm, &h);
+    }
+}
+
+// a flush split over writer threads in batches of ioDepth pages: pinned pages are left alone,
+// new pages grow the file, and the pool stays usable while the batches are written
+void
+testParallelFlush (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *held = MAKE_PAGE_HANDLE();
+    BM_PoolOptions opts;
+    BM_FlushOptions flush;
+    BM_FrameInfo info[16];
+    BM_Stats stats;
+    FlushWatch watch;
+    SM_FileHandle fh;
+    PageNumber fresh;
+    char *disk = malloc(PAGE_SIZE);
+    char expect[32];
+    int i, n, dirty = 0;
+    testName = "Parallel pool flush";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+    for (i = 0; i < 12; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(shutdownBufferPool(bm));
+
+    memset(&opts, 0, sizeof(opts));
+    opts.concurrent = TRUE;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 16, RS_LRU, NULL, &opts));
+    for (i = 0; i < 12; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "%s-%i", "Flush", i);
+        CHECK(markDirty(bm, h));
+        if (i == 3)
+            *held = *h;
+        else
+            CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinNewPage(bm, h, &fresh));
+    ASSERT_EQUALS_INT(12, fresh, "new page past the end");
+    sprintf(h->data, "%s-%i", "Flush", fresh);
+    CHECK(unpinPageDirty(bm, h, TRUE));
+    CHECK(resetPoolStats(bm));
+
+    memset(&flush, 0, sizeof(flush));
+    flush.numThreads = -1;
+    ASSERT_ERROR(forceFlushPoolWithOptions(bm, &flush), "negative thread count");
+    flush.numThreads = 4;
+    flush.ioDepth = 3;
+    flush.progress = watchFlush;
+    memset(&watch, 0, sizeof(watch));
+    watch.bm = bm;
+    watch.monotonic = 1;
+    flush.progressArg = &watch;
+    CHECK(forceFlushPoolWithOptions(bm, &flush));
+    CHECK(watch.rc);
+    ASSERT_EQUALS_INT(4, watch.calls, "one progress call per batch");
+    ASSERT_TRUE(watch.monotonic && watch.lastDone == 12 && watch.lastTotal == 12, "progress ends at the total");
+
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(12, (int) stats.writeIO, "unpinned dirty pages written once");
+    CHECK(getFrameSnapshot(bm, 0, info, 16, &n));
+    for (i = 0; i < n; i++)
+        if (info[i].dirty)
+        {
+            dirty++;
+            ASSERT_TRUE(info[i].pageNum == 0 || info[i].pageNum == 3, "only the pinned and rewritten pages dirty");
+        }
+    ASSERT_EQUALS_INT(2, dirty, "dirty frames left");
+
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    ASSERT_EQUALS_INT(13, fh.totalNumPages, "file grew by the new page");
+    for (i = 0; i <= 12; i++)
+    {
+        CHECK(readBlock(i, &fh, disk));
+        if (i == 3)
+            continue;
+        sprintf(expect, "%s-%i", "Flush", i);
+        ASSERT_EQUALS_STRING(expect, disk, "page on disk");
+    }
+    CHECK(readBlock(3, &fh, disk));
+    ASSERT_TRUE(strcmp(disk, "Flush-3") != 0, "pinned page not written");
+    CHECK(closePageFile(&fh));
+
+    // the plain call finishes what is left once the page is unpinned
+    CHECK(unpinPage(bm, held));
+    CHECK(forceFlushPool(bm));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(14, (int) stats.writeIO, "rewritten and unpinned pages written");
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(disk);
+    free(bm);
+    free(h);
+    free(held);
+    TEST_DONE();
+}
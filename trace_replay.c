@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+#include "access_trace.h"
+#include "dberror.h"
+
+// Replays an access trace (see startAccessTrace) against every replacement strategy at
+// a range of pool sizes and prints hit ratio and I/O per run.
+//
+//   trace_replay.exe <trace file> [frames ...]
+//
+// Without explicit sizes the pool runs at 1/64 .. 1x of the distinct pages in the trace.
+// Page numbers are renumbered densely per file first, so the scratch files hold only as
+// many pages as the trace touches, however far apart the traced page numbers were.
+
+#define MAX_SIZES 32
+#define SCRATCH_NAME "trace_replay_%d.bin"
+
+typedef struct Access { // a record plus its position in the file, to keep the sort stable
+    TraceRecord rec;
+    long seq;
+} Access;
+
+static const char *strategyNames[] = {"FIFO", "LRU", "CLOCK", "LFU", "LRU-K"};
+
+static int byTime(const void *a, const void *b) {
+    const Access *x = (const Access*)a, *y = (const Access*)b;
+    if (x->rec.tsNs != y->rec.tsNs) return (x->rec.tsNs < y->rec.tsNs) ? -1 : 1;
+    return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+static int byKey(const void *a, const void *b) {
+    unsigned long long x = *(const unsigned long long*)a, y = *(const unsigned long long*)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+static unsigned long long pageKey(const TraceRecord *r) {
+    return ((unsigned long long)r->fileId << 32) | (uint32_t)r->pageNum;
+}
+
+// rewrite each page number as its rank among the file's traced pages; the order, and so any
+// sequential runs, survive
+static RC densePages(Access *acc, long n) {
+    unsigned long long *keys = (unsigned long long*)malloc(sizeof(unsigned long long) * (n > 0 ? n : 1));
+    long *firstOfFile = (long*)malloc(sizeof(long) * (n > 0 ? n : 1));
+    if (keys == NULL || firstOfFile == NULL) {
+        free(keys);
+        free(firstOfFile);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    for (long i = 0; i < n; i++) keys[i] = pageKey(&acc[i].rec);
+    qsort(keys, n, sizeof(unsigned long long), byKey);
+    long k = 0;
+    for (long i = 0; i < n; i++) {
+        if (i > 0 && keys[i] == keys[k - 1]) continue;
+        // index of the file's lowest key, for ranks that restart at 0 in every file
+        firstOfFile[k] = (k > 0 && (keys[k - 1] >> 32) == (keys[i] >> 32)) ? firstOfFile[k - 1] : k;
+        keys[k++] = keys[i];
+    }
+    for (long i = 0; i < n; i++) {
+        unsigned long long key = pageKey(&acc[i].rec);
+        unsigned long long *at = (unsigned long long*)bsearch(&key, keys, k, sizeof(unsigned long long), byKey);
+        long idx = at - keys;
+        acc[i].rec.pageNum = (int)(idx - firstOfFile[idx]);
+    }
+    free(keys);
+    free(firstOfFile);
+    return RC_OK;
+}
+
+static long countDistinctPages(Access *acc, long n) {
+    unsigned long long *keys = (unsigned long long*)malloc(sizeof(unsigned long long) * (n > 0 ? n : 1));
+    if (keys == NULL) return 0;
+    long k = 0;
+    for (long i = 0; i < n; i++) {
+        if (acc[i].rec.op != TRACE_PIN) continue;
+        keys[k++] = pageKey(&acc[i].rec);
+    }
+    qsort(keys, k, sizeof(unsigned long long), byKey);
+    long distinct = 0;
+    for (long i = 0; i < k; i++) {
+        if (i == 0 || keys[i] != keys[i - 1]) distinct++;
+    }
+    free(keys);
+    return distinct;
+}
+
+static RC replay(Access *acc, long n, int maxFileId, ReplacementStrategy strat, int frames, BM_Stats *stats) {
+    BM_BufferPool bm;
+    BM_PageHandle h;
+    char name[64];
+    memset(&h, 0, sizeof(h));
+    int *poolFile = (int*)calloc(maxFileId + 1, sizeof(int)); // trace fileId -> pool fileId
+
+    if (poolFile == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    snprintf(name, sizeof(name), SCRATCH_NAME, 0);
+    RC rc = initBufferPool(&bm, name, frames, strat, NULL);
+    for (int f = 1; rc == RC_OK && f <= maxFileId; f++) {
+        snprintf(name, sizeof(name), SCRATCH_NAME, f);
+        rc = openPoolFile(&bm, name, &poolFile[f]);
+    }
+    if (rc != RC_OK) {
+        free(poolFile);
+        return rc;
+    }
+
+    // errors are part of the result: a pin fails when every frame is pinned
+    for (long i = 0; i < n; i++) {
+        const TraceRecord *r = &acc[i].rec;
+        int fileId = poolFile[r->fileId];
+        switch (r->op) {
+        case TRACE_PIN:
+            (void)pinFilePage(&bm, &h, fileId, r->pageNum);
+            break;
+        case TRACE_UNPIN:
+            memset(&h, 0, sizeof(h)); // a hand-built handle: no frame hint, found by page number
+            h.pageNum = r->pageNum;
+            (void)unpinFilePage(&bm, &h, fileId);
+            break;
+        case TRACE_MARK_DIRTY:
+            memset(&h, 0, sizeof(h));
+            h.pageNum = r->pageNum;
+            (void)markFileDirty(&bm, &h, fileId);
+            break;
+        }
+    }
+
+    rc = getPoolStats(&bm, stats);
+    (void)shutdownBufferPool(&bm);
+    free(poolFile);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <trace file> [frames ...]\n", argv[0]);
+        return 1;
+    }
+
+    TraceRecord *records = NULL;
+    long n = 0;
+    RC rc = readTraceFile(argv[1], &records, &n);
+    if (rc != RC_OK) {
+        fprintf(stderr, "%s: cannot read trace (rc %d)\n", argv[1], rc);
+        return 1;
+    }
+
+    // threads were drained ring by ring; put them back into one timeline
+    Access *acc = (Access*)malloc(sizeof(Access) * (n > 0 ? n : 1));
+    if (acc == NULL) return 1;
+    int maxFileId = 0;
+    for (long i = 0; i < n; i++) {
+        acc[i].rec = records[i];
+        acc[i].seq = i;
+        if (records[i].fileId > maxFileId) maxFileId = records[i].fileId;
+    }
+    free(records);
+    qsort(acc, n, sizeof(Access), byTime);
+    if (densePages(acc, n) != RC_OK) return 1;
+
+    int sizes[MAX_SIZES];
+    int numSizes = 0;
+    long distinct = countDistinctPages(acc, n);
+    if (argc > 2) {
+        for (int a = 2; a < argc && numSizes < MAX_SIZES; a++) {
+            int s = atoi(argv[a]);
+            if (s > 0) sizes[numSizes++] = s;
+        }
+    } else {
+        for (int div = 64; div >= 1; div /= 2) {
+            int s = (int)(distinct / div);
+            if (s > 0 && (numSizes == 0 || sizes[numSizes - 1] != s)) sizes[numSizes++] = s;
+        }
+    }
+    if (numSizes == 0) sizes[numSizes++] = 1;
+
+    char name[64];
+    for (int f = 0; f <= maxFileId; f++) {
+        snprintf(name, sizeof(name), SCRATCH_NAME, f);
+        if (createPageFile(name) != RC_OK) {
+            fprintf(stderr, "cannot create %s\n", name);
+            return 1;
+        }
+    }
+
+    printf("%ld records, %ld distinct pages\n", n, distinct);
+    printf("%-6s %10s %8s %12s %12s %10s\n", "policy", "frames", "hit%", "reads", "writes", "failed");
+    for (int s = 0; s < numSizes; s++) {
+        for (int strat = RS_FIFO; strat <= RS_LRU_K; strat++) {
+            BM_Stats st;
+            rc = replay(acc, n, maxFileId, (ReplacementStrategy)strat, sizes[s], &st);
+            if (rc != RC_OK) {
+                fprintf(stderr, "replay failed (rc %d)\n", rc);
+                return 1;
+            }
+            uint64_t refs = st.hits + st.misses;
+            printf("%-6s %10d %7.2f%% %12llu %12llu %10llu\n", strategyNames[strat], sizes[s],
+                   refs ? 100.0 * (double)st.hits / (double)refs : 0.0,
+                   (unsigned long long)st.readIO, (unsigned long long)st.writeIO,
+                   (unsigned long long)st.failedPins);
+        }
+    }
+
+    for (int f = 0; f <= maxFileId; f++) {
+        snprintf(name, sizeof(name), SCRATCH_NAME, f);
+        (void)destroyPageFile(name);
+    }
+    free(acc);
+    return 0;
+}
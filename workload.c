@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "workload.h"
+
+// TPC-C page regions as shares of numPages; orders, new-orders, order-lines and history
+// share the rest and grow by appending at head
+#define TPCC_WD_SHARE 0.01
+#define TPCC_CUSTOMER_SHARE 0.20
+#define TPCC_STOCK_SHARE 0.35
+#define TPCC_ITEM_SHARE 0.10
+
+static unsigned long long nextRandom(Workload *wl) { // splitmix64
+    unsigned long long z = (wl->rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double uniform01(Workload *wl) { // [0, 1)
+    return (double)(nextRandom(wl) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int uniformInt(Workload *wl, int lo, int hi) { // [lo, hi]
+    return lo + (int)(nextRandom(wl) % (unsigned long long)(hi - lo + 1));
+}
+
+static double zeta(int n, double theta) {
+    double sum = 0.0;
+    for (int i = 1; i <= n; i++) sum += 1.0 / pow((double)i, theta);
+    return sum;
+}
+
+static int zipfian(Workload *wl) { // Gray et al., "Quickly generating billion-record synthetic databases"
+    int n = wl->spec.numPages;
+    double u = uniform01(wl);
+    double uz = u * wl->zetan;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + pow(0.5, wl->spec.theta)) return 1;
+    int k = (int)((double)n * pow(wl->eta * u - wl->eta + 1.0, wl->alpha));
+    return (k < n) ? k : n - 1;
+}
+
+// TPC-C non-uniform random over [x, y]; a is scaled to the region instead of the spec's fixed values
+static int nuRand(Workload *wl, int x, int y) {
+    int size = y - x + 1;
+    int a = 1;
+    while (a < size / 4) a <<= 1;
+    a -= 1;
+    return x + ((uniformInt(wl, 0, a) | uniformInt(wl, 0, size - 1)) + 7) % size;
+}
+
+static void txnAdd(Workload *wl, int page, bool write) {
+    if (wl->txnLen == WL_TXN_MAX) return;
+    wl->txnPages[wl->txnLen] = page;
+    wl->txnWrites[wl->txnLen] = write;
+    wl->txnLen++;
+}
+
+typedef struct TpccLayout { // regions of a TPC-C file: warehouse+districts, customer, stock, item, order
+    int wd, cust, stock, item, orders;
+    int custBase, stockBase, itemBase, orderBase;
+} TpccLayout;
+
+static TpccLayout tpccLayout(int n) { // orders < 1 when n is too small to give every region a page
+    TpccLayout t;
+    t.wd = (int)(n * TPCC_WD_SHARE);
+    t.cust = (int)(n * TPCC_CUSTOMER_SHARE);
+    t.stock = (int)(n * TPCC_STOCK_SHARE);
+    t.item = (int)(n * TPCC_ITEM_SHARE);
+    if (t.wd < 2) t.wd = 2;
+    if (t.cust < 1) t.cust = 1;
+    if (t.stock < 1) t.stock = 1;
+    if (t.item < 1) t.item = 1;
+    t.custBase = t.wd;
+    t.stockBase = t.custBase + t.cust;
+    t.itemBase = t.stockBase + t.stock;
+    t.orderBase = t.itemBase + t.item;
+    t.orders = n - t.orderBase;
+    return t;
+}
+
+static void nextTransaction(Workload *wl) { // expand one TPC-C transaction into its page accesses
+    TpccLayout t = tpccLayout(wl->spec.numPages);
+    int wd = t.wd, cust = t.cust, stock = t.stock, item = t.item, orders = t.orders;
+    int custBase = t.custBase, stockBase = t.stockBase, itemBase = t.itemBase, orderBase = t.orderBase;
+    int district = uniformInt(wl, 1, wd - 1);
+    int recent = orderBase + (wl->head - uniformInt(wl, 0, 3) + orders) % orders;
+
+    wl->txnLen = 0;
+    wl->txnPos = 0;
+    int mix = uniformInt(wl, 1, 100);
+    if (mix <= 45) { // new-order
+        txnAdd(wl, 0, FALSE);
+        txnAdd(wl, district, TRUE);
+        txnAdd(wl, nuRand(wl, custBase, custBase + cust - 1), FALSE);
+        int lines = uniformInt(wl, 5, 15);
+        for (int i = 0; i < lines; i++) {
+            txnAdd(wl, nuRand(wl, itemBase, itemBase + item - 1), FALSE);
+            txnAdd(wl, nuRand(wl, stockBase, stockBase + stock - 1), TRUE);
+        }
+        txnAdd(wl, orderBase + wl->head, TRUE);
+        if (uniformInt(wl, 0, 3) == 0) wl->head = (wl->head + 1) % orders; // a few orders per page
+    } else if (mix <= 88) { // payment
+        txnAdd(wl, 0, TRUE);
+        txnAdd(wl, district, TRUE);
+        txnAdd(wl, nuRand(wl, custBase, custBase + cust - 1), TRUE);
+        txnAdd(wl, orderBase + wl->head, TRUE); // history insert
+    } else if (mix <= 92) { // order-status
+        txnAdd(wl, nuRand(wl, custBase, custBase + cust - 1), FALSE);
+        txnAdd(wl, recent, FALSE);
+    } else if (mix <= 96) { // delivery: the oldest undelivered order of each district
+        int oldest = orderBase + (wl->head + orders - orders / 4) % orders;
+        for (int d = 0; d < 10; d++) {
+            txnAdd(wl, oldest, TRUE);
+            txnAdd(wl, nuRand(wl, custBase, custBase + cust - 1), TRUE);
+        }
+    } else { // stock-level
+        txnAdd(wl, district, FALSE);
+        for (int i = 0; i < 20; i++) {
+            txnAdd(wl, recent, FALSE);
+            txnAdd(wl, nuRand(wl, stockBase, stockBase + stock - 1), FALSE);
+        }
+    }
+}
+
+RC initWorkload(Workload *wl, const WorkloadSpec *spec) {
+    if (wl == NULL || spec == NULL || spec->numPages <= 0) return RC_FILE_HANDLE_NOT_INIT;
+    if (spec->writeRatio < 0.0 || spec->writeRatio > 1.0) return RC_FILE_HANDLE_NOT_INIT;
+    memset(wl, 0, sizeof(Workload));
+    wl->spec = *spec;
+    wl->rng = spec->seed;
+
+    switch (spec->kind) {
+    case WL_ZIPFIAN:
+    case WL_LATEST:
+        if (!(spec->theta > 0.0) || spec->theta >= 1.0) return RC_FILE_HANDLE_NOT_INIT;
+        wl->zetan = zeta(spec->numPages, spec->theta);
+        wl->zeta2 = zeta(2, spec->theta);
+        wl->alpha = 1.0 / (1.0 - spec->theta);
+        wl->eta = (1.0 - pow(2.0 / spec->numPages, 1.0 - spec->theta)) / (1.0 - wl->zeta2 / wl->zetan);
+        break;
+    case WL_LOOP_SCAN:
+        if (spec->loopPages <= 0 || spec->loopPages > spec->numPages) return RC_FILE_HANDLE_NOT_INIT;
+        break;
+    case WL_HOTSET_SHIFT:
+        if (spec->hotPages <= 0 || spec->hotPages > spec->numPages || spec->shiftEvery <= 0) return RC_FILE_HANDLE_NOT_INIT;
+        if (spec->hotFraction < 0.0 || spec->hotFraction > 1.0) return RC_FILE_HANDLE_NOT_INIT;
+        break;
+    case WL_TPCC:
+        if (tpccLayout(spec->numPages).orders < 1) return RC_FILE_HANDLE_NOT_INIT;
+        break;
+    case WL_UNIFORM:
+    case WL_SEQ_SCAN:
+        break;
+    default:
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    return RC_OK;
+}
+
+void nextAccess(Workload *wl, PageNumber *page, bool *write) {
+    int n = wl->spec.numPages;
+    bool w = (uniform01(wl) < wl->spec.writeRatio) ? TRUE : FALSE;
+    int p = 0;
+
+    switch (wl->spec.kind) {
+    case WL_UNIFORM:
+        p = uniformInt(wl, 0, n - 1);
+        break;
+    case WL_ZIPFIAN:
+        p = zipfian(wl);
+        break;
+    case WL_LATEST:
+        if (w) {
+            wl->head = (wl->head + 1) % n;
+            p = wl->head;
+        } else {
+            p = (wl->head - zipfian(wl) + n) % n;
+        }
+        break;
+    case WL_SEQ_SCAN:
+        p = (int)(wl->issued % n);
+        break;
+    case WL_LOOP_SCAN:
+        p = (int)(wl->issued % wl->spec.loopPages);
+        break;
+    case WL_HOTSET_SHIFT:
+        if (wl->issued > 0 && wl->issued % wl->spec.shiftEvery == 0)
+            wl->hotBase = (wl->hotBase + wl->spec.hotPages) % n;
+        if (uniform01(wl) < wl->spec.hotFraction)
+            p = (wl->hotBase + uniformInt(wl, 0, wl->spec.hotPages - 1)) % n;
+        else
+            p = uniformInt(wl, 0, n - 1);
+        break;
+    case WL_TPCC:
+        if (wl->txnPos == wl->txnLen) nextTransaction(wl);
+        p = wl->txnPages[wl->txnPos];
+        w = wl->txnWrites[wl->txnPos];
+        wl->txnPos++;
+        break;
+    }
+    wl->issued++;
+    *page = p;
+    *write = w;
+}
+
+RC runWorkload(BM_BufferPool *const bm, Workload *wl, long numAccesses) {
+    if (bm == NULL || wl == NULL) return RC_FILE_HANDLE_NOT_INIT;
+    BM_PageHandle h;
+    PageNumber p;
+    bool w;
+    memset(&h, 0, sizeof(h));
+    for (long i = 0; i < numAccesses; i++) {
+        nextAccess(wl, &p, &w);
+        RC rc = pinPage(bm, &h, p);
+        if (rc != RC_OK) return rc;
+        // page content is left alone: concurrent drivers may share a pinned page, and the pool has no page latches
+        rc = unpinPageDirty(bm, &h, w);
+        if (rc != RC_OK) return rc;
+    }
+    return RC_OK;
+}
@@ -0,0 +1,50 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include "dberror.h"
+#include "buffer_mgr.h"
+
+// Synthetic page reference streams for benchmarks and stress tests
+typedef enum WorkloadKind {
+	WL_UNIFORM = 0,
+	WL_ZIPFIAN = 1,       // page k is chosen with weight 1/(k+1)^theta; page 0 is hottest
+	WL_LATEST = 2,        // writes append at a moving head, reads are Zipfian by distance behind it
+	WL_SEQ_SCAN = 3,      // 0, 1, ..., numPages-1, then again
+	WL_LOOP_SCAN = 4,     // 0 .. loopPages-1 over and over
+	WL_HOTSET_SHIFT = 5,  // hotFraction of accesses go to hotPages pages; the set moves every shiftEvery accesses
+	WL_TPCC = 6           // TPC-C transaction mix over warehouse/district/customer/stock/item/order regions;
+	                      // needs numPages >= 7, so every region has a page of its own
+} WorkloadKind;
+
+typedef struct WorkloadSpec {
+	WorkloadKind kind;
+	int numPages;          // pages addressed, [0, numPages)
+	double theta;          // Zipfian skew, 0 < theta < 1 (0.99 is the YCSB default)
+	double writeRatio;     // share of accesses that mark the page dirty; TPC-C uses its own mix
+	int loopPages;         // WL_LOOP_SCAN
+	int hotPages;          // WL_HOTSET_SHIFT
+	double hotFraction;    // WL_HOTSET_SHIFT
+	long shiftEvery;       // WL_HOTSET_SHIFT
+	unsigned long long seed;
+} WorkloadSpec;
+
+#define WL_TXN_MAX 64
+
+typedef struct Workload {
+	WorkloadSpec spec;
+	unsigned long long rng;
+	long issued;           // accesses handed out so far
+	double zetan, zeta2, alpha, eta; // Zipfian constants over numPages
+	int head;              // WL_LATEST append position, WL_TPCC order-table tail
+	int hotBase;           // WL_HOTSET_SHIFT first hot page
+	int txnPages[WL_TXN_MAX];  // WL_TPCC: accesses of the current transaction
+	bool txnWrites[WL_TXN_MAX];
+	int txnLen, txnPos;
+} Workload;
+
+RC initWorkload (Workload *wl, const WorkloadSpec *spec);
+void nextAccess (Workload *wl, PageNumber *page, bool *write);
+// pin, optionally markDirty, unpin for numAccesses references of the pool's page file
+RC runWorkload (BM_BufferPool *const bm, Workload *wl, long numAccesses);
+
+#endif